@@ -0,0 +1,198 @@
+#pragma once
+#ifndef RANGE_OF_POINTERS_ABBREVIATED_KEYS_HPP
+#define RANGE_OF_POINTERS_ABBREVIATED_KEYS_HPP
+
+// Abbreviated keys: an order preserving 64-bit prefix of every pointee's key, kept next to its
+// pointer (abbreviated_ptr). Sorting, Unique and binary search compare the prefixes and only
+// dereference both pointees when the prefixes tie, which keeps most comparisons of string keyed
+// ranges out of the pointees and out of the strings' heap buffers.
+//
+// `abbreviate(const T&) -> std::uint64_t` must agree with the comparisons used with it:
+// comp(a, b) implies abbreviate(a) <= abbreviate(b), and pred(a, b) implies
+// abbreviate(a) == abbreviate(b). AbbreviateString and AbbreviateInteger build such prefixes.
+
+#include "RangeOfPointers.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+
+namespace range_of_ptrs {
+
+	template<typename T>
+	struct abbreviated_ptr {
+		std::uint64_t key;
+		T* ptr;
+	};
+
+	// The first 8 bytes, big endian and zero padded: compares like the strings themselves
+	// (std::string_view::compare) as long as the prefixes differ.
+	inline std::uint64_t AbbreviateString(std::string_view str) noexcept
+	{
+		std::uint64_t key = 0;
+		const std::size_t size = std::min<std::size_t>(str.size(), 8);
+		for (std::size_t i = 0; i < size; ++i)
+			key |= std::uint64_t{ static_cast<unsigned char>(str[i]) } << (56 - 8 * i);
+		return key;
+	}
+
+	// Integers of up to 64 bits, signed ones shifted so that the unsigned order matches.
+	template<typename Integer>
+	constexpr std::uint64_t AbbreviateInteger(Integer value) noexcept
+	{
+		static_assert(std::is_integral_v<Integer> && sizeof(Integer) <= sizeof(std::uint64_t), "integer of up to 64 bits expected");
+		if constexpr (std::is_signed_v<Integer>)
+			return static_cast<std::uint64_t>(static_cast<std::int64_t>(value)) ^ (std::uint64_t{ 1 } << 63);
+		else
+			return static_cast<std::uint64_t>(value);
+	}
+
+
+	template<typename Compare>
+	struct AbbreviatedCompareAdapter {
+		AbbreviatedCompareAdapter() = default;
+		explicit AbbreviatedCompareAdapter(Compare comp) : comp_{ comp } {}
+
+		template<typename T>
+		bool operator()(const abbreviated_ptr<T>& lhs, const abbreviated_ptr<T>& rhs) const {
+			if (lhs.key != rhs.key)
+				return lhs.key < rhs.key;
+			assert(lhs.ptr != nullptr);
+			assert(rhs.ptr != nullptr);
+			return comp_(*lhs.ptr, *rhs.ptr);
+		}
+
+	private:
+		Compare comp_;
+	};
+
+	template<typename BinaryPredicate>
+	struct AbbreviatedEqualAdapter {
+		AbbreviatedEqualAdapter() = default;
+		explicit AbbreviatedEqualAdapter(BinaryPredicate pred) : pred_{ pred } {}
+
+		template<typename T>
+		bool operator()(const abbreviated_ptr<T>& lhs, const abbreviated_ptr<T>& rhs) const {
+			if (lhs.key != rhs.key)
+				return false;
+			assert(lhs.ptr != nullptr);
+			assert(rhs.ptr != nullptr);
+			return pred_(*lhs.ptr, *rhs.ptr);
+		}
+
+	private:
+		BinaryPredicate pred_;
+	};
+
+
+	// The pointers of [first, last) with their abbreviated keys, in range order.
+	template<typename InIter, typename Abbreviate>
+	std::vector<abbreviated_ptr<std::remove_pointer_t<typename std::iterator_traits<InIter>::value_type>>>
+		AbbreviateRange(InIter first, InIter last, Abbreviate abbreviate)
+	{
+		RANGE_OF_PTRS_PERF_SCOPE("AbbreviateRange", detail::PerfRangeSize(first, last));
+		using PointeeType = std::remove_pointer_t<typename std::iterator_traits<InIter>::value_type>;
+
+		std::vector<abbreviated_ptr<PointeeType>> result;
+		if constexpr (detail::IsRandomAccessIter<InIter>())
+			result.reserve(static_cast<std::size_t>(last - first));
+		for (; first != last; ++first) {
+			assert(*first != nullptr);
+			result.push_back({ static_cast<std::uint64_t>(abbreviate(*(*first))), *first });
+		}
+		return result;
+	}
+
+	// Unique over abbreviated pointers: the pointees of the removed elements are deleted and their
+	// ptr set to nullptr, as with Unique.
+	template<typename ForwardIt, typename BinaryPredicate = std::equal_to<>>
+	ForwardIt UniqueAbbreviated(ForwardIt first, ForwardIt last, BinaryPredicate pred = BinaryPredicate())
+	{
+		RANGE_OF_PTRS_PERF_SCOPE("UniqueAbbreviated", detail::PerfRangeSize(first, last));
+		if (first == last)
+			return last;
+
+		const AbbreviatedEqualAdapter<BinaryPredicate> equal{ pred };
+		auto result = first;
+		while (++first != last) {
+			if (!equal(*result, *first)) {
+				++result;
+				*result = *first;
+			}
+			else {
+				RANGE_OF_PTRS_DELETE(first->ptr, "UniqueAbbreviated");
+				first->ptr = nullptr;
+			}
+		}
+		++result;
+		return result;
+	}
+
+	// Binary search in abbreviated pointers sorted with AbbreviatedCompareAdapter<Compare>.
+	template<typename ForwardIt, typename T, typename Abbreviate, typename Compare = std::less<>>
+	ForwardIt LowerBoundAbbreviated(ForwardIt first, ForwardIt last, const T& value, Abbreviate abbreviate, Compare comp = Compare())
+	{
+		const auto key = static_cast<std::uint64_t>(abbreviate(value));
+		return std::lower_bound(first, last, value, [key, comp](const auto& element, const T& rhs) {
+			if (element.key != key)
+				return element.key < key;
+			return comp(*element.ptr, rhs);
+		});
+	}
+
+	template<typename ForwardIt, typename T, typename Abbreviate, typename Compare = std::less<>>
+	ForwardIt UpperBoundAbbreviated(ForwardIt first, ForwardIt last, const T& value, Abbreviate abbreviate, Compare comp = Compare())
+	{
+		const auto key = static_cast<std::uint64_t>(abbreviate(value));
+		return std::upper_bound(first, last, value, [key, comp](const T& lhs, const auto& element) {
+			if (key != element.key)
+				return key < element.key;
+			return comp(lhs, *element.ptr);
+		});
+	}
+
+	template<typename ForwardIt, typename T, typename Abbreviate, typename Compare = std::less<>>
+	bool BinarySearchAbbreviated(ForwardIt first, ForwardIt last, const T& value, Abbreviate abbreviate, Compare comp = Compare())
+	{
+		first = LowerBoundAbbreviated(first, last, value, abbreviate, comp);
+		return first != last && !comp(value, *first->ptr);
+	}
+
+
+	// Sorts the pointer range [first, last) by comp on the pointees.
+	template<typename RandomIt, typename Abbreviate, typename Compare = std::less<>>
+	void SortAbbreviated(RandomIt first, RandomIt last, Abbreviate abbreviate, Compare comp = Compare())
+	{
+		RANGE_OF_PTRS_PERF_SCOPE("SortAbbreviated", detail::PerfRangeSize(first, last));
+		auto keys = AbbreviateRange(first, last, abbreviate);
+		std::sort(std::begin(keys), std::end(keys), AbbreviatedCompareAdapter<Compare>(comp));
+		for (const auto& element : keys)
+			*first++ = element.ptr;
+	}
+
+	// Sort + Unique of the pointer range [first, last) in one pass of abbreviations. Returns the end
+	// of the unique part; the duplicates are deleted and the rest of the range is set to nullptr.
+	template<typename RandomIt, typename Abbreviate, typename Compare = std::less<>, typename BinaryPredicate = std::equal_to<>>
+	RandomIt SortUniqueAbbreviated(RandomIt first, RandomIt last, Abbreviate abbreviate, Compare comp = Compare(), BinaryPredicate pred = BinaryPredicate())
+	{
+		RANGE_OF_PTRS_PERF_SCOPE("SortUniqueAbbreviated", detail::PerfRangeSize(first, last));
+		auto keys = AbbreviateRange(first, last, abbreviate);
+		std::sort(std::begin(keys), std::end(keys), AbbreviatedCompareAdapter<Compare>(comp));
+		const auto unique = UniqueAbbreviated(std::begin(keys), std::end(keys), pred);
+
+		RandomIt result = first;
+		for (auto it = std::begin(keys); it != unique; ++it)
+			*result++ = it->ptr;
+		std::fill(result, last, nullptr);
+		return result;
+	}
+}
+
+#endif // !RANGE_OF_POINTERS_ABBREVIATED_KEYS_HPP
@@ -0,0 +1,149 @@
+#pragma once
+#ifndef RANGE_OF_POINTERS_ALIASING_HPP
+#define RANGE_OF_POINTERS_ALIASING_HPP
+
+// Ranges where the same pointer occurs in several slots (index tables and the like).
+//
+// DeepCopyOfRange(preserve_aliasing, first, last) copies every distinct pointee once and repeats
+// the copy wherever the source repeats the pointer, so the result aliases exactly like the source.
+// Such a container must be owned by raii_ptrs_aliased_container_wrapper (or freed with
+// DeleteDistinct), which deletes every distinct pointee once.
+
+#include "RangeOfPointers.hpp"
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <type_traits>
+#include <vector>
+
+
+namespace range_of_ptrs {
+
+	struct preserve_aliasing_t { explicit preserve_aliasing_t() = default; };
+	inline constexpr preserve_aliasing_t preserve_aliasing{};
+
+	namespace detail {
+		// Open addressing map from non-null pointers to the position where each was seen first.
+		class first_occurrence_map {
+		public:
+			explicit first_occurrence_map(std::size_t size)
+			{
+				std::size_t capacity = 16;
+				while (capacity < size * 2)
+					capacity *= 2;
+				shift_ = 64;
+				for (std::size_t c = capacity; c > 1; c /= 2)
+					--shift_;
+				slots_.resize(capacity);
+			}
+
+			// The position stored for `ptr`; `position` is stored first if `ptr` is new.
+			std::size_t find_or_insert(const void* ptr, std::size_t position) noexcept
+			{
+				assert(ptr != nullptr);
+				const std::size_t mask = slots_.size() - 1;
+				for (std::size_t i = hash(ptr);; i = (i + 1) & mask) {
+					slot& s = slots_[i];
+					if (s.ptr == ptr)
+						return s.position;
+					if (s.ptr == nullptr) {
+						s = slot{ ptr, position };
+						return position;
+					}
+				}
+			}
+
+		private:
+			struct slot {
+				const void* ptr = nullptr;
+				std::size_t position = 0;
+			};
+
+			std::size_t hash(const void* ptr) const noexcept
+			{
+				return static_cast<std::size_t>((static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(ptr)) * 0x9E3779B97F4A7C15ull) >> shift_);
+			}
+
+			std::vector<slot> slots_;
+			unsigned shift_ = 0;
+		};
+	}
+
+
+	// Deletes every distinct non-null pointer of [first, last) once.
+	template<typename ForwardIt>
+	void DeleteDistinct(ForwardIt first, ForwardIt last)
+	{
+		RANGE_OF_PTRS_PERF_SCOPE("DeleteDistinct", detail::PerfRangeSize(first, last));
+		detail::first_occurrence_map seen{ static_cast<std::size_t>(std::distance(first, last)) };
+		for (std::size_t position = 0; first != last; ++first, ++position) {
+			if (*first != nullptr && seen.find_or_insert(*first, position) == position)
+				RANGE_OF_PTRS_DELETE(*first, "DeleteDistinct");
+		}
+	}
+
+
+	// Counterpart of raii_ptrs_container_wrapper for containers whose slots may share pointees:
+	// the destructor deletes every distinct non-null pointee once.
+	template<typename Container, typename = std::enable_if_t<std::is_pointer_v<typename Container::value_type>>>
+	struct raii_ptrs_aliased_container_wrapper {
+		raii_ptrs_aliased_container_wrapper() = default;
+		explicit raii_ptrs_aliased_container_wrapper(const Container& container) : pCont_{ &container } {}
+		~raii_ptrs_aliased_container_wrapper() {
+			if (pCont_ == nullptr) return;
+			DeleteDistinct(std::begin(*pCont_), std::end(*pCont_));
+		}
+
+		raii_ptrs_aliased_container_wrapper(const raii_ptrs_aliased_container_wrapper&) = delete;
+		raii_ptrs_aliased_container_wrapper& operator=(const raii_ptrs_aliased_container_wrapper&) = delete;
+
+		raii_ptrs_aliased_container_wrapper(raii_ptrs_aliased_container_wrapper&&) = delete;
+		raii_ptrs_aliased_container_wrapper& operator=(raii_ptrs_aliased_container_wrapper&&) = delete;
+
+		void change_container(const Container& container) { pCont_ = &container; }
+		void release() { pCont_ = nullptr; }
+
+	private:
+		const Container* pCont_ = nullptr;
+	};
+
+
+	// Deep copy that keeps the aliasing of the source: one `new ValueType` per distinct pointee.
+	template<typename ToContainer, typename It>
+	ToContainer DeepCopyOfRange(preserve_aliasing_t, It first, It last)
+	{
+		RANGE_OF_PTRS_PERF_SCOPE("DeepCopyOfRangeAliased", detail::PerfRangeSize(first, last));
+		using PtrType = typename std::iterator_traits<It>::value_type;
+		using ValueType = std::remove_pointer_t<PtrType>;
+		static_assert(std::is_same_v<typename ToContainer::value_type, PtrType>, "pointer types must match");
+
+		ToContainer result;
+		raii_ptrs_aliased_container_wrapper<ToContainer> backout{ result };
+
+		const auto size = static_cast<std::size_t>(std::distance(first, last));
+		detail::first_occurrence_map seen{ size };
+		result.reserve(size);
+		auto dest = std::back_inserter(result);
+		for (std::size_t position = 0; first != last; ++first, ++position, ++dest) {
+			assert(*first != nullptr);
+			const std::size_t leader = seen.find_or_insert(*first, position);
+			if (leader == position)
+				detail::WriteOwned(dest, RANGE_OF_PTRS_ADOPT(new ValueType(*(*first)), "DeepCopyOfRangeAliased"));
+			else
+				*dest = result[leader];
+		}
+
+		backout.release();
+		return result;
+	}
+
+	template<typename FromContainer, typename ToContainer = FromContainer>
+	ToContainer DeepCopy(preserve_aliasing_t, const FromContainer& container)
+	{
+		return DeepCopyOfRange<ToContainer>(preserve_aliasing, std::cbegin(container), std::cend(container));
+	}
+}
+
+#endif // !RANGE_OF_POINTERS_ALIASING_HPP
@@ -0,0 +1,182 @@
+#pragma once
+#ifndef RANGE_OF_POINTERS_ARG_SORT_HPP
+#define RANGE_OF_POINTERS_ARG_SORT_HPP
+
+// ArgSortByKey(first, last, proj): the stable ascending order of the pointees by proj(pointee), as
+// 32-bit positions into [first, last), for ranges that must not be reordered themselves.
+// The range is only read: the keys are cached in a contiguous array first, then integral keys are
+// radix sorted (LSD, 8 bits per pass, passes where all keys share the digit are skipped) and other
+// keys std::stable_sort'ed. Inputs of argsort_options::parallel_threshold elements and more are
+// split across threads for the key extraction and the sort.
+
+#include "RangeOfPointers.hpp"
+#include "Parallel.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <numeric>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+
+namespace range_of_ptrs {
+
+	struct argsort_options {
+		unsigned threads = 0;                                       // 0: std::thread::hardware_concurrency()
+		std::size_t parallel_threshold = std::size_t{ 1 } << 18;    // smaller inputs stay on the calling thread
+	};
+
+	namespace detail {
+		// func(part, begin, end) for `parts` contiguous slices of [0, size), one thread per slice
+		// (see ParallelParts for the exception handling).
+		template<typename Func>
+		void ParallelSlices(std::size_t size, unsigned parts, Func func)
+		{
+			const auto slice = [&](unsigned part) { return size / parts * part + std::min<std::size_t>(part, size % parts); };
+			if (parts == 1) {
+				func(0u, std::size_t{ 0 }, size);
+				return;
+			}
+
+			ParallelParts(parts, [&](std::size_t part) {
+				const auto index = static_cast<unsigned>(part);
+				func(index, slice(index), slice(index + 1));
+			});
+		}
+
+		template<typename Key>
+		constexpr bool IsRadixKey() { return std::is_integral_v<Key> && !std::is_same_v<Key, bool>; }
+
+		// Unsigned key with the same order: the sign bit of signed keys is flipped.
+		template<typename Key>
+		constexpr std::make_unsigned_t<Key> RadixKey(Key key) noexcept
+		{
+			using Unsigned = std::make_unsigned_t<Key>;
+			if constexpr (std::is_signed_v<Key>)
+				return static_cast<Unsigned>(static_cast<Unsigned>(key) ^ (Unsigned{ 1 } << (std::numeric_limits<Unsigned>::digits - 1)));
+			else
+				return key;
+		}
+
+		// Stable LSD radix sort of `order` by `keys`, which are permuted along.
+		template<typename Unsigned>
+		void RadixArgSort(std::vector<Unsigned>& keys, std::vector<std::uint32_t>& order, unsigned parts)
+		{
+			constexpr unsigned digitBits = 8;
+			constexpr std::size_t buckets = std::size_t{ 1 } << digitBits;
+			const std::size_t size = keys.size();
+
+			std::vector<Unsigned> keysOut(size);
+			std::vector<std::uint32_t> orderOut(size);
+			std::vector<std::array<std::size_t, buckets>> counts(parts);
+
+			for (unsigned shift = 0; shift < std::numeric_limits<Unsigned>::digits; shift += digitBits) {
+				ParallelSlices(size, parts, [&](unsigned part, std::size_t begin, std::size_t end) {
+					auto& count = counts[part];
+					count.fill(0);
+					for (std::size_t i = begin; i < end; ++i)
+						++count[(keys[i] >> shift) & (buckets - 1)];
+				});
+
+				// Every slice of every bucket gets its place after all lower buckets and the earlier slices.
+				std::size_t offset = 0;
+				bool sameDigit = false;
+				for (std::size_t digit = 0; digit < buckets; ++digit) {
+					std::size_t total = 0;
+					for (unsigned part = 0; part < parts; ++part) {
+						const std::size_t count = counts[part][digit];
+						counts[part][digit] = offset + total;
+						total += count;
+					}
+					sameDigit = sameDigit || total == size;
+					offset += total;
+				}
+				if (sameDigit)
+					continue;
+
+				ParallelSlices(size, parts, [&](unsigned part, std::size_t begin, std::size_t end) {
+					auto& position = counts[part];
+					for (std::size_t i = begin; i < end; ++i) {
+						const std::size_t to = position[(keys[i] >> shift) & (buckets - 1)]++;
+						keysOut[to] = keys[i];
+						orderOut[to] = order[i];
+					}
+				});
+				keys.swap(keysOut);
+				order.swap(orderOut);
+			}
+		}
+
+		// Stable sort of `order` by keys[order[i]]: slices sorted in parallel, then merged pairwise.
+		template<typename Key>
+		void ComparisonArgSort(const std::vector<Key>& keys, std::vector<std::uint32_t>& order, unsigned parts)
+		{
+			const auto less = [&keys](std::uint32_t lhs, std::uint32_t rhs) { return keys[lhs] < keys[rhs]; };
+
+			std::vector<std::size_t> bounds(parts + 1);
+			ParallelSlices(order.size(), parts, [&](unsigned part, std::size_t begin, std::size_t end) {
+				std::stable_sort(std::begin(order) + begin, std::begin(order) + end, less);
+				bounds[part + 1] = end;
+			});
+
+			for (std::size_t width = 1; width < parts; width *= 2) {
+				for (std::size_t part = 0; part + width < parts; part += 2 * width) {
+					const std::size_t last = std::min<std::size_t>(part + 2 * width, parts);
+					std::inplace_merge(std::begin(order) + bounds[part], std::begin(order) + bounds[part + width], std::begin(order) + bounds[last], less);
+				}
+			}
+		}
+	}
+
+
+	template<typename RandomIt, typename Projection>
+	std::vector<std::uint32_t> ArgSortByKey(RandomIt first, RandomIt last, Projection proj, const argsort_options& options = argsort_options())
+	{
+		RANGE_OF_PTRS_PERF_SCOPE("ArgSortByKey", detail::PerfRangeSize(first, last));
+		using PointeeType = std::remove_pointer_t<typename std::iterator_traits<RandomIt>::value_type>;
+		using Key = std::decay_t<std::invoke_result_t<Projection&, const PointeeType&>>;
+
+		const auto size = static_cast<std::size_t>(last - first);
+		assert(size <= std::numeric_limits<std::uint32_t>::max());
+
+		unsigned parts = 1;
+		if (size >= options.parallel_threshold && size != 0) {
+			parts = options.threads != 0 ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+			parts = static_cast<unsigned>(std::min<std::size_t>(parts, size));
+		}
+
+		std::vector<std::uint32_t> order(size);
+		std::iota(std::begin(order), std::end(order), std::uint32_t{ 0 });
+
+		if constexpr (detail::IsRadixKey<Key>()) {
+			std::vector<std::make_unsigned_t<Key>> keys(size);
+			detail::ParallelSlices(size, parts, [&](unsigned, std::size_t begin, std::size_t end) {
+				for (std::size_t i = begin; i < end; ++i) {
+					assert(first[i] != nullptr);
+					keys[i] = detail::RadixKey<Key>(std::invoke(proj, *first[i]));
+				}
+			});
+			detail::RadixArgSort(keys, order, parts);
+		}
+		else {
+			std::vector<Key> keys(size);
+			detail::ParallelSlices(size, parts, [&](unsigned, std::size_t begin, std::size_t end) {
+				for (std::size_t i = begin; i < end; ++i) {
+					assert(first[i] != nullptr);
+					keys[i] = std::invoke(proj, *first[i]);
+				}
+			});
+			detail::ComparisonArgSort(keys, order, parts);
+		}
+		return order;
+	}
+}
+
+#endif // !RANGE_OF_POINTERS_ARG_SORT_HPP
@@ -0,0 +1,42 @@
+#pragma once
+#ifndef RANGE_OF_POINTERS_BITS_HPP
+#define RANGE_OF_POINTERS_BITS_HPP
+
+// Bit counting on 64-bit masks, shared by the mask based algorithms (Branchless, NullPointers,
+// Selection).
+
+#include <cassert>
+#include <cstdint>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+
+namespace range_of_ptrs {
+
+	namespace detail {
+		inline unsigned CountTrailingZeros(std::uint64_t mask) noexcept
+		{
+			assert(mask != 0);
+#if defined(_MSC_VER) && !defined(__clang__)
+			unsigned long index;
+			_BitScanForward64(&index, mask);
+			return static_cast<unsigned>(index);
+#else
+			return static_cast<unsigned>(__builtin_ctzll(mask));
+#endif
+		}
+
+		inline unsigned PopCount64(std::uint64_t mask) noexcept
+		{
+#if defined(_MSC_VER) && !defined(__clang__)
+			return static_cast<unsigned>(__popcnt64(mask));
+#else
+			return static_cast<unsigned>(__builtin_popcountll(mask));
+#endif
+		}
+	}
+}
+
+#endif // !RANGE_OF_POINTERS_BITS_HPP
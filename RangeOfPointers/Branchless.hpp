@@ -0,0 +1,91 @@
+#pragma once
+#ifndef RANGE_OF_POINTERS_BRANCHLESS_HPP
+#define RANGE_OF_POINTERS_BRANCHLESS_HPP
+
+// CopyIf / CloneIf for predicates the branch predictor can not learn (around 50 % selectivity on
+// random data): CopyIf(branchless, first, last, dest, pred).
+//
+// The predicate is evaluated for blocks of 64 elements into a bitmask with no branch on its
+// result, then only the set bits are visited. Iterators that are not random access fall back
+// to the plain algorithms. With a selectivity close to 0 % or 100 % the branches of the plain
+// algorithms are predicted well and those are faster (see the CopyIf* benchmark cases).
+
+#include "RangeOfPointers.hpp"
+#include "Bits.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <type_traits>
+
+
+namespace range_of_ptrs {
+
+	struct branchless_t { explicit branchless_t() = default; };
+	inline constexpr branchless_t branchless{};
+
+	namespace detail {
+		constexpr std::size_t selectBlockSize = 64;
+
+		// Bit i is set when the pointee of first[i] satisfies pred, for i < size <= selectBlockSize.
+		template<typename RandomIt, typename Pred>
+		std::uint64_t SelectMask(RandomIt first, std::size_t size, Pred& pred)
+		{
+			std::uint64_t mask = 0;
+			for (std::size_t i = 0; i < size; ++i) {
+				assert(first[i] != nullptr);
+				mask |= static_cast<std::uint64_t>(static_cast<bool>(pred(*first[i]))) << i;
+			}
+			return mask;
+		}
+	}
+
+
+	template<typename InIter, typename OutIter, typename Pred>
+	OutIter CopyIf(branchless_t, InIter first, InIter last, OutIter dest, Pred pred)
+	{
+		if constexpr (!detail::IsRandomAccessIter<InIter>()) {
+			return CopyIf(first, last, dest, pred);
+		}
+		else {
+			RANGE_OF_PTRS_PERF_SCOPE("CopyIfBranchless", detail::PerfRangeSize(first, last));
+			// No lambda capturing dest by reference: the pointee stores could alias it and force reloads.
+			for (std::size_t size = static_cast<std::size_t>(last - first); size != 0;) {
+				const std::size_t block = std::min(size, detail::selectBlockSize);
+				for (std::uint64_t mask = detail::SelectMask(first, block, pred); mask != 0; mask &= mask - 1) {
+					assert(*dest != nullptr);
+					*(*dest) = *first[detail::CountTrailingZeros(mask)];
+					++dest;
+				}
+				first += block;
+				size -= block;
+			}
+			return dest;
+		}
+	}
+
+	template<typename InIter, typename OutIter, typename Pred>
+	OutIter CloneIf(branchless_t, InIter first, InIter last, OutIter dest, Pred pred)
+	{
+		if constexpr (!detail::IsRandomAccessIter<InIter>()) {
+			return CloneIf(first, last, dest, pred);
+		}
+		else {
+			RANGE_OF_PTRS_PERF_SCOPE("CloneIfBranchless", detail::PerfRangeSize(first, last));
+			for (std::size_t size = static_cast<std::size_t>(last - first); size != 0;) {
+				const std::size_t block = std::min(size, detail::selectBlockSize);
+				for (std::uint64_t mask = detail::SelectMask(first, block, pred); mask != 0; mask &= mask - 1) {
+					detail::WriteOwned(dest, RANGE_OF_PTRS_ADOPT(first[detail::CountTrailingZeros(mask)]->Clone(), "CloneIf"));
+					++dest;
+				}
+				first += block;
+				size -= block;
+			}
+			return dest;
+		}
+	}
+}
+
+#endif // !RANGE_OF_POINTERS_BRANCHLESS_HPP
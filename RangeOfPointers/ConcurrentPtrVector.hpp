@@ -0,0 +1,210 @@
+#pragma once
+#ifndef RANGE_OF_POINTERS_CONCURRENT_PTR_VECTOR_HPP
+#define RANGE_OF_POINTERS_CONCURRENT_PTR_VECTOR_HPP
+
+#include "RangeOfPointers.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <thread>
+#include <utility>
+#include <vector>
+
+
+namespace range_of_ptrs {
+
+	// Append-only owning vector of pointers that any number of threads can push into without a lock.
+	// Slots live in segments of doubling size that are never moved, so a slot address stays valid
+	// for the lifetime of the container. The destructor deletes every pointee.
+	//
+	// push_back publishes the segment of the next free index with a CAS the first time it is
+	// touched, then reserves the index with a CAS on the size and stores the pointer. An index is
+	// only reserved once its segment exists, so a failed segment allocation reserves nothing.
+	// snapshot() may run concurrently with pushes: it copies the slots that were reserved before
+	// the call and waits for the ones still being written, which takes no longer than one store.
+	// The segments come from `Allocator` (rebound to the slot type); the pointees are `new T`.
+	template<typename T, typename Allocator = std::allocator<std::atomic<T*>>>
+	class concurrent_ptr_vector {
+	public:
+		using value_type = T*;
+		using size_type = std::size_t;
+		using allocator_type = typename std::allocator_traits<Allocator>::template rebind_alloc<std::atomic<T*>>;
+
+		concurrent_ptr_vector() = default;
+		explicit concurrent_ptr_vector(const allocator_type& alloc) : alloc_{ alloc } {}
+
+		concurrent_ptr_vector(const concurrent_ptr_vector&) = delete;
+		concurrent_ptr_vector& operator=(const concurrent_ptr_vector&) = delete;
+
+		concurrent_ptr_vector(concurrent_ptr_vector&&) = delete;
+		concurrent_ptr_vector& operator=(concurrent_ptr_vector&&) = delete;
+
+		~concurrent_ptr_vector()
+		{
+			destroy_pointees();
+			for (size_type segment = 0; segment < segmentsCount; ++segment) {
+				if (std::atomic<T*>* slots = segments_[segment].load(std::memory_order_relaxed))
+					deallocate_segment(slots, segment);
+			}
+		}
+
+		// Takes ownership of `ptr` and returns its index. `ptr` must not be null.
+		size_type push_back(T* ptr)
+		{
+			assert(ptr != nullptr);
+
+			size_type index = size_.load(std::memory_order_relaxed);
+			std::atomic<T*>* slot;
+			try {
+				do {
+					slot = slot_at(index, true);
+				} while (!size_.compare_exchange_weak(index, index + 1, std::memory_order_release, std::memory_order_relaxed));
+			}
+			catch (...) {
+				RANGE_OF_PTRS_DELETE(ptr, "concurrent_ptr_vector::push_back");
+				throw;
+			}
+			slot->store(ptr, std::memory_order_release);
+			return index;
+		}
+
+		template<typename... Args>
+		size_type emplace_back(Args&&... args)
+		{
+			return push_back(RANGE_OF_PTRS_ADOPT(new T(std::forward<Args>(args)...), "concurrent_ptr_vector::emplace_back"));
+		}
+
+		// Pointer at `index`; the push that returned `index` must have completed.
+		T* operator[](size_type index) const
+		{
+			assert(index < size());
+			return slot_at(index, false)->load(std::memory_order_acquire);
+		}
+
+		// Number of reserved slots, including ones still being written.
+		size_type size() const noexcept { return size_.load(std::memory_order_acquire); }
+		bool empty() const noexcept { return size() == 0; }
+
+		// Non-owning copy of the pointers pushed so far, in index order. The pointees stay owned by the
+		// container, so only algorithms that do not delete (Copy*, Clone*, DeepCopy*) may run on it.
+		std::vector<T*> snapshot() const
+		{
+			const size_type count = size();
+			std::vector<T*> result;
+			result.reserve(count);
+
+			for (size_type segment = 0, base = 0; base < count; base += segment_size(segment), ++segment) {
+				const std::atomic<T*>* slots = segments_[segment].load(std::memory_order_acquire);
+				assert(slots != nullptr);
+				const size_type last = std::min(count - base, segment_size(segment));
+				for (size_type i = 0; i < last; ++i) {
+					T* ptr = slots[i].load(std::memory_order_acquire);
+					while (ptr == nullptr) {
+						std::this_thread::yield();
+						ptr = slots[i].load(std::memory_order_acquire);
+					}
+					result.push_back(ptr);
+				}
+			}
+			return result;
+		}
+
+		// Transfers ownership of all pointees to the returned vector (wrap it with
+		// raii_ptrs_container_wrapper to run Remove, Unique and friends) and empties the container.
+		// Must not run concurrently with push_back.
+		std::vector<T*> release()
+		{
+			std::vector<T*> result = snapshot();
+			clear_slots(result.size());
+			size_.store(0, std::memory_order_release);
+			return result;
+		}
+
+	private:
+		static constexpr size_type firstSegmentSize = 64;
+		static constexpr size_type segmentsCount = 48;
+
+		static constexpr size_type segment_size(size_type segment) noexcept { return firstSegmentSize << segment; }
+
+		// Segment k holds the indices [firstSegmentSize * (2^k - 1), firstSegmentSize * (2^(k+1) - 1)).
+		static void locate(size_type index, size_type& segment, size_type& offset) noexcept
+		{
+			const size_type scaled = index / firstSegmentSize + 1;
+			segment = 0;
+			while ((scaled >> (segment + 1)) != 0)
+				++segment;
+			offset = index - firstSegmentSize * ((size_type{ 1 } << segment) - 1);
+		}
+
+		std::atomic<T*>* slot_at(size_type index, bool allocate) const
+		{
+			size_type segment, offset;
+			locate(index, segment, offset);
+			assert(segment < segmentsCount);
+
+			std::atomic<T*>* slots = segments_[segment].load(std::memory_order_acquire);
+			if (slots == nullptr) {
+				assert(allocate);
+				(void)allocate;
+				std::atomic<T*>* fresh = allocate_segment(segment);
+				if (segments_[segment].compare_exchange_strong(slots, fresh, std::memory_order_acq_rel))
+					slots = fresh;
+				else
+					deallocate_segment(fresh, segment);
+			}
+			return slots + offset;
+		}
+
+		std::atomic<T*>* allocate_segment(size_type segment) const
+		{
+			allocator_type alloc = alloc_;
+			std::atomic<T*>* slots = std::allocator_traits<allocator_type>::allocate(alloc, segment_size(segment));
+			for (size_type i = 0; i < segment_size(segment); ++i)
+				::new (static_cast<void*>(slots + i)) std::atomic<T*>(nullptr);
+			return slots;
+		}
+
+		void deallocate_segment(std::atomic<T*>* slots, size_type segment) const noexcept
+		{
+			allocator_type alloc = alloc_;
+			std::allocator_traits<allocator_type>::deallocate(alloc, slots, segment_size(segment));
+		}
+
+		// Visits the slots [0, count) of the segments that were allocated.
+		template<typename Func>
+		void for_each_slot(size_type count, Func func)
+		{
+			for (size_type segment = 0, base = 0; base < count; base += segment_size(segment), ++segment) {
+				std::atomic<T*>* slots = segments_[segment].load(std::memory_order_acquire);
+				if (slots == nullptr) continue;
+
+				const size_type last = std::min(count - base, segment_size(segment));
+				for (size_type i = 0; i < last; ++i)
+					func(slots[i]);
+			}
+		}
+
+		void destroy_pointees()
+		{
+			for_each_slot(size_.load(std::memory_order_acquire), [](std::atomic<T*>& slot) {
+				RANGE_OF_PTRS_DELETE(slot.load(std::memory_order_acquire), "concurrent_ptr_vector");
+			});
+		}
+
+		void clear_slots(size_type count)
+		{
+			for_each_slot(count, [](std::atomic<T*>& slot) { slot.store(nullptr, std::memory_order_relaxed); });
+		}
+
+		allocator_type alloc_;
+		mutable std::array<std::atomic<std::atomic<T*>*>, segmentsCount> segments_ = {};
+		std::atomic<size_type> size_{ 0 };
+	};
+}
+
+#endif // !RANGE_OF_POINTERS_CONCURRENT_PTR_VECTOR_HPP
@@ -0,0 +1,344 @@
+#pragma once
+#ifndef RANGE_OF_POINTERS_EXTERNAL_SORT_HPP
+#define RANGE_OF_POINTERS_EXTERNAL_SORT_HPP
+
+// Sort + Unique for ranges of trivially copyable pointees that do not fit in memory.
+// The input is cut into runs of external_sort_options::memory_bytes; every run is sorted by
+// pointer (BinaryFunctorDerefPtrsAdapter), deduplicated and spilled in the Serialize format to
+// an unlinked temporary file. The runs are then k-way merged, dropping the duplicates across runs.
+// The sort is stable: equal objects keep their input order, so Unique keeps the first of them.
+// Input that fits into one run never touches the disk. POSIX only.
+
+#include "RangeOfPointers.hpp"
+#include "StreamingCopy.hpp"
+
+#ifdef RANGE_OF_PTRS_HAS_POSIX_IO
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <optional>
+#include <queue>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <sys/types.h>
+
+
+namespace range_of_ptrs {
+
+	struct external_sort_options {
+		std::size_t memory_bytes = std::size_t{ 256 } << 20;  // budget for a run, and for all merge buffers together
+		std::string temp_dir;                                 // empty: $TMPDIR, then /tmp
+	};
+
+	namespace detail {
+		// Anonymous temporary file: unlinked as soon as it is created, closed by the destructor.
+		class temp_file {
+		public:
+			explicit temp_file(const std::string& dir)
+			{
+				std::string path = dir;
+				if (path.empty()) {
+					const char* env = std::getenv("TMPDIR");
+					path = env != nullptr && *env != '\0' ? env : "/tmp";
+				}
+				path += "/range_of_ptrs-XXXXXX";
+
+				fd_ = ::mkstemp(path.data());
+				if (fd_ < 0)
+					throw std::system_error(errno, std::generic_category(), "range_of_ptrs: mkstemp");
+				::unlink(path.c_str());
+			}
+
+			temp_file(const temp_file&) = delete;
+			temp_file& operator=(const temp_file&) = delete;
+			temp_file(temp_file&& other) noexcept : fd_{ std::exchange(other.fd_, -1) } {}
+			temp_file& operator=(temp_file&&) = delete;
+
+			~temp_file() { if (fd_ >= 0) ::close(fd_); }
+
+			int fd() const noexcept { return fd_; }
+
+		private:
+			int fd_ = -1;
+		};
+
+		// Buffered writer of a serialized range whose length is known only at the end.
+		template<typename T>
+		class run_writer {
+		public:
+			run_writer(int fd, T* buffer, std::size_t capacity) : fd_{ fd }, buffer_{ buffer }, capacity_{ capacity } {}
+
+			void operator()(const T& value)
+			{
+				if (size_ == capacity_)
+					flush();
+				buffer_[size_++] = value;
+				++count_;
+			}
+
+			std::uint64_t finish()
+			{
+				flush();
+				const serialized_header header = MakeSerializedHeader<T>(count_);
+				static const char padding[64] = {};
+				PwriteAll(fd_, &header, sizeof(header), 0);
+				PwriteAll(fd_, padding, header.data_offset - sizeof(header), sizeof(header));
+				if (::ftruncate(fd_, static_cast<off_t>(offset_)) != 0)
+					throw std::system_error(errno, std::generic_category(), "range_of_ptrs: ftruncate");
+				return count_;
+			}
+
+		private:
+			void flush()
+			{
+				PwriteAll(fd_, buffer_, size_ * sizeof(T), offset_);
+				offset_ += size_ * sizeof(T);
+				size_ = 0;
+			}
+
+			int fd_;
+			T* buffer_;
+			std::size_t capacity_;
+			std::size_t size_ = 0;
+			std::uint64_t count_ = 0;
+			std::uint64_t offset_ = MakeSerializedHeader<T>(0).data_offset;
+		};
+
+		// Buffers objects and spills every full buffer as a sorted, duplicate free run.
+		template<typename T, typename Compare, typename BinaryPredicate>
+		class run_builder {
+		public:
+			run_builder(std::size_t capacity, const external_sort_options& options, Compare comp, BinaryPredicate pred, std::vector<temp_file>& runs)
+				: capacity_{ capacity }, options_{ options }, comp_{ comp }, pred_{ pred }, runs_{ runs }
+			{
+				buffer_ = arena_.allocate<T>(capacity_);
+				staging_ = arena_.allocate<T>(stagingSize());
+				sorted_.reserve(capacity_);
+			}
+
+			void add(const T& value)
+			{
+				if (size_ == capacity_)
+					spill();
+				buffer_[size_++] = value;
+			}
+
+			// Sorted, duplicate free pointers to the buffered objects.
+			const std::vector<const T*>& sort()
+			{
+				sorted_.clear();
+				for (std::size_t i = 0; i < size_; ++i)
+					sorted_.push_back(buffer_ + i);
+
+				std::stable_sort(std::begin(sorted_), std::end(sorted_), BinaryFunctorDerefPtrsAdapter<Compare>(comp_));
+				sorted_.erase(std::unique(std::begin(sorted_), std::end(sorted_), BinaryFunctorDerefPtrsAdapter<BinaryPredicate>(pred_)), std::end(sorted_));
+				return sorted_;
+			}
+
+			void spill()
+			{
+				if (size_ == 0) return;
+
+				// Sorted objects are gathered through a small staging buffer, so the run goes out in large sequential writes.
+				sort();
+				temp_file run{ options_.temp_dir };
+				run_writer<T> writer{ run.fd(), staging_, stagingSize() };
+				for (const T* ptr : sorted_)
+					writer(*ptr);
+				writer.finish();
+				runs_.push_back(std::move(run));
+				size_ = 0;
+			}
+
+		private:
+			std::size_t stagingSize() const noexcept { return std::min<std::size_t>(capacity_, std::max<std::size_t>((std::size_t{ 1 } << 20) / sizeof(T), 1)); }
+
+			std::size_t capacity_;
+			const external_sort_options& options_;
+			Compare comp_;
+			BinaryPredicate pred_;
+			std::vector<temp_file>& runs_;
+
+			ptr_arena arena_;
+			T* buffer_ = nullptr;
+			T* staging_ = nullptr;
+			std::size_t size_ = 0;
+			std::vector<const T*> sorted_;
+		};
+
+		// Sequential buffered reader of one spilled run.
+		template<typename T>
+		class run_reader {
+		public:
+			run_reader(int fd, T* buffer, std::size_t capacity) : fd_{ fd }, buffer_{ buffer }, capacity_{ capacity }
+			{
+				serialized_header header;
+				PreadAll(fd_, &header, sizeof(header), 0);
+				ValidateSerializedHeader<T>(header);
+				offset_ = header.data_offset;
+				remaining_ = header.count;
+				refill();
+			}
+
+			bool empty() const noexcept { return pos_ == end_; }
+			const T& front() const noexcept { return buffer_[pos_]; }
+			void pop() { if (++pos_ == end_) refill(); }
+
+		private:
+			void refill()
+			{
+				const auto count = static_cast<std::size_t>(std::min<std::uint64_t>(remaining_, capacity_));
+				PreadAll(fd_, buffer_, count * sizeof(T), offset_);
+				offset_ += count * sizeof(T);
+				remaining_ -= count;
+				pos_ = 0;
+				end_ = count;
+			}
+
+			int fd_;
+			T* buffer_;
+			std::size_t capacity_;
+			std::uint64_t offset_ = 0;
+			std::uint64_t remaining_ = 0;
+			std::size_t pos_ = 0;
+			std::size_t end_ = 0;
+		};
+
+		// feed(builder) calls builder.add() for every input object; emit(const T&) receives the
+		// sorted unique objects.
+		template<typename T, typename Compare, typename BinaryPredicate, typename Feed, typename Emit>
+		void ExternalSortUnique(Feed feed, Emit emit, Compare comp, BinaryPredicate pred, const external_sort_options& options)
+		{
+			static_assert(std::is_trivially_copyable_v<T>, "external sort requires trivially copyable objects");
+			constexpr std::size_t minMergeBuffer = 4096;
+
+			std::vector<temp_file> runs;
+			{
+				const std::size_t capacity = std::max<std::size_t>(options.memory_bytes / (sizeof(T) + sizeof(T*)), 1);
+				run_builder<T, Compare, BinaryPredicate> builder{ capacity, options, comp, pred, runs };
+				feed(builder);
+
+				if (runs.empty()) {
+					for (const T* ptr : builder.sort())
+						emit(*ptr);
+					return;
+				}
+				builder.spill();
+			}
+
+			// One buffer per run, leaving a share of the budget to the output.
+			const std::size_t perBuffer = std::max(options.memory_bytes / (runs.size() + 1) / sizeof(T), minMergeBuffer);
+			ptr_arena buffers;
+
+			std::vector<run_reader<T>> readers;
+			readers.reserve(runs.size());
+			for (const auto& run : runs)
+				readers.emplace_back(run.fd(), buffers.allocate<T>(perBuffer), perBuffer);
+
+			// Runs hold consecutive parts of the input, so ties go to the earlier run.
+			auto greater = [&](std::size_t lhs, std::size_t rhs) {
+				if (comp(readers[rhs].front(), readers[lhs].front())) return true;
+				return !comp(readers[lhs].front(), readers[rhs].front()) && rhs < lhs;
+			};
+			std::priority_queue<std::size_t, std::vector<std::size_t>, decltype(greater)> heads(greater);
+			for (std::size_t i = 0; i < readers.size(); ++i) {
+				if (!readers[i].empty()) heads.push(i);
+			}
+
+			std::optional<T> last;
+			while (!heads.empty()) {
+				const std::size_t head = heads.top();
+				heads.pop();
+
+				const T& value = readers[head].front();
+				if (!last || !pred(*last, value)) {
+					emit(value);
+					last = value;
+				}
+
+				readers[head].pop();
+				if (!readers[head].empty())
+					heads.push(head);
+			}
+		}
+	}
+
+
+	// Sorts the serialized range in `inFd` by `comp`, drops the objects equal (by `pred`) to their
+	// predecessor and writes the result as a serialized range to `outFd`, which is truncated to it.
+	// The descriptors are not owned.
+	template<typename T, typename Compare = std::less<>, typename BinaryPredicate = std::equal_to<>>
+	stream_result ExternalSortUniqueFile(int inFd, int outFd, Compare comp = Compare(), BinaryPredicate pred = BinaryPredicate(),
+		const external_sort_options& options = external_sort_options())
+	{
+		serialized_header header;
+		detail::PreadAll(inFd, &header, sizeof(header), 0);
+		ValidateSerializedHeader<T>(header);
+
+		stream_result result;
+		result.read = header.count;
+
+		const std::size_t chunk = std::max<std::size_t>(options.memory_bytes / 16 / sizeof(T), 1);
+		ptr_arena buffers;
+		detail::run_writer<T> writer{ outFd, buffers.allocate<T>(chunk), chunk };
+		detail::ExternalSortUnique<T>(
+			[&](auto& builder) {
+				T* buffer = buffers.allocate<T>(chunk);
+				std::uint64_t offset = header.data_offset;
+				for (std::uint64_t left = header.count; left != 0;) {
+					const auto count = static_cast<std::size_t>(std::min<std::uint64_t>(left, chunk));
+					detail::PreadAll(inFd, buffer, count * sizeof(T), offset);
+					for (std::size_t i = 0; i < count; ++i)
+						builder.add(buffer[i]);
+					offset += count * sizeof(T);
+					left -= count;
+				}
+			},
+			[&](const T& value) { writer(value); },
+			comp, pred, options);
+
+		result.written = writer.finish();
+		return result;
+	}
+
+	// Returns an owning container with `new T` copies of the sorted unique pointees of [first, last).
+	template<typename Container, typename Iter, typename Compare = std::less<>, typename BinaryPredicate = std::equal_to<>>
+	Container ExternalSortUnique(Iter first, Iter last, Compare comp = Compare(), BinaryPredicate pred = BinaryPredicate(),
+		const external_sort_options& options = external_sort_options())
+	{
+		RANGE_OF_PTRS_PERF_SCOPE("ExternalSortUnique", detail::PerfRangeSize(first, last));
+		using ValueType = std::remove_cv_t<std::remove_pointer_t<typename std::iterator_traits<Iter>::value_type>>;
+
+		Container result;
+		raii_ptrs_container_wrapper<Container> backout{ result };
+
+		detail::ExternalSortUnique<ValueType>(
+			[&](auto& builder) {
+				for (; first != last; ++first) {
+					assert(*first != nullptr);
+					builder.add(*(*first));
+				}
+			},
+			[&](const ValueType& value) {
+				ValueType* ptr = RANGE_OF_PTRS_ADOPT(new ValueType(value), "ExternalSortUnique");
+				raii_ptrs_range_wrapper<ValueType**> owner{ &ptr, &ptr + 1 };
+				result.push_back(ptr);
+				owner.release();
+			},
+			comp, pred, options);
+
+		backout.release();
+		return result;
+	}
+}
+
+#endif // RANGE_OF_PTRS_HAS_POSIX_IO
+
+#endif // !RANGE_OF_POINTERS_EXTERNAL_SORT_HPP
@@ -0,0 +1,220 @@
+#pragma once
+#ifndef RANGE_OF_POINTERS_LAYOUT_ANALYSIS_HPP
+#define RANGE_OF_POINTERS_LAYOUT_ANALYSIS_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <type_traits>
+#include <unordered_set>
+
+
+namespace range_of_ptrs {
+
+	enum class layout_recommendation {
+		none,
+		remove_nulls,
+		deduplicate,
+		sort_by_address,
+		compact
+	};
+
+	inline const char* to_string(layout_recommendation recommendation)
+	{
+		switch (recommendation) {
+		case layout_recommendation::none: return "layout is sequential, nothing to do";
+		case layout_recommendation::remove_nulls: return "remove nulls recommended";
+		case layout_recommendation::deduplicate: return "deduplicate pointers recommended";
+		case layout_recommendation::sort_by_address: return "sort by address recommended";
+		case layout_recommendation::compact: return "compact recommended";
+		}
+		return "";
+	}
+
+	struct layout_options {
+		// Upper bound on the number of consecutive pointer pairs that are inspected.
+		// 0 inspects every pair. Sampling needs random access iterators to pay off.
+		std::size_t max_samples = 0;
+
+		// A pair is forward-sequential when the next pointee starts at most this many
+		// bytes after the current one. 0 means 2 * sizeof(pointee) rounded up to a cache line.
+		std::size_t sequential_stride = 0;
+
+		std::size_t page_size = 4096;
+		std::size_t cache_line_size = 64;
+	};
+
+	struct layout_report {
+		std::size_t elements = 0;       // length of the analyzed range
+		std::size_t examined = 0;       // pointers actually looked at
+		std::size_t nulls = 0;
+		std::size_t duplicates = 0;     // examined non-null pointers seen before
+
+		std::size_t pairs = 0;          // consecutive non-null pairs
+		std::size_t forward_pairs = 0;
+		std::size_t backward_pairs = 0;
+		std::size_t sequential_pairs = 0;
+
+		// delta_histogram[k] counts pairs whose |address delta| has bit width k (k == 0 for equal addresses).
+		std::array<std::size_t, 65> delta_histogram = {};
+
+		std::size_t distinct_pages = 0;
+		std::size_t distinct_cache_lines = 0;
+		std::size_t ideal_pages = 0;    // pages the distinct examined pointees would fill if they were packed
+
+		layout_recommendation recommendation = layout_recommendation::none;
+
+		double null_fraction() const noexcept { return examined == 0 ? 0.0 : double(nulls) / double(examined); }
+		double duplicate_fraction() const noexcept { return examined == 0 ? 0.0 : double(duplicates) / double(examined); }
+		double sequential_fraction() const noexcept { return pairs == 0 ? 1.0 : double(sequential_pairs) / double(pairs); }
+		double page_spread() const noexcept { return ideal_pages == 0 ? 1.0 : double(distinct_pages) / double(ideal_pages); }
+	};
+
+
+	namespace detail {
+
+		inline std::size_t BitWidth(std::uintptr_t value)
+		{
+			std::size_t width = 0;
+			for (; value != 0; value >>= 1)
+				++width;
+			return width;
+		}
+
+		struct LayoutAccumulator {
+			LayoutAccumulator(layout_report& report, const layout_options& options, std::size_t valueSize)
+				: report_{ report }, options_{ options }, valueSize_{ valueSize }
+			{
+				stride_ = options.sequential_stride;
+				if (stride_ == 0) {
+					const std::size_t line = options.cache_line_size == 0 ? 1 : options.cache_line_size;
+					stride_ = (2 * valueSize + line - 1) / line * line;
+				}
+			}
+
+			void visit(const void* ptr)
+			{
+				++report_.examined;
+				if (ptr == nullptr) {
+					++report_.nulls;
+					return;
+				}
+
+				const auto addr = reinterpret_cast<std::uintptr_t>(ptr);
+				if (!seen_.insert(addr).second)
+					++report_.duplicates;
+				pages_.insert(addr / options_.page_size);
+				lines_.insert(addr / options_.cache_line_size);
+			}
+
+			void visit_pair(const void* current, const void* next)
+			{
+				if (current == nullptr || next == nullptr)
+					return;
+
+				const auto from = reinterpret_cast<std::uintptr_t>(current);
+				const auto to = reinterpret_cast<std::uintptr_t>(next);
+
+				++report_.pairs;
+				if (to > from) {
+					++report_.forward_pairs;
+					if (to - from <= stride_)
+						++report_.sequential_pairs;
+				}
+				else if (to < from) {
+					++report_.backward_pairs;
+				}
+				++report_.delta_histogram[BitWidth(to > from ? to - from : from - to)];
+			}
+
+			void finish()
+			{
+				report_.distinct_pages = pages_.size();
+				report_.distinct_cache_lines = lines_.size();
+
+				// Both sides of page_spread() refer to the same pointees: the pages the examined ones
+				// touch against the pages they would fill packed. When sampling this makes a range
+				// whose sample is spread over many more pages than its size look scattered.
+				report_.ideal_pages = (seen_.size() * valueSize_ + options_.page_size - 1) / options_.page_size;
+
+				if (report_.null_fraction() > 0.1)
+					report_.recommendation = layout_recommendation::remove_nulls;
+				else if (report_.duplicate_fraction() > 0.1)
+					report_.recommendation = layout_recommendation::deduplicate;
+				else if (report_.sequential_fraction() >= 0.9)
+					report_.recommendation = layout_recommendation::none;
+				else if (report_.page_spread() > 4.0)
+					report_.recommendation = layout_recommendation::compact;
+				else
+					report_.recommendation = layout_recommendation::sort_by_address;
+			}
+
+		private:
+			layout_report& report_;
+			const layout_options& options_;
+			std::size_t valueSize_;
+			std::size_t stride_ = 0;
+			std::unordered_set<std::uintptr_t> seen_;
+			std::unordered_set<std::uintptr_t> pages_;
+			std::unordered_set<std::uintptr_t> lines_;
+		};
+	}
+
+
+	// Inspects the addresses stored in [first, last) without dereferencing them.
+	// With options.max_samples != 0 and random access iterators only evenly spaced
+	// consecutive pairs are inspected, so the cost is bounded regardless of the range size;
+	// counts in the report then refer to the examined sample. A sample that is small against
+	// the pages of the range spreads over them even when the range is dense, so sampled
+	// unordered ranges lean towards `compact` rather than `sort_by_address`.
+	template<typename Iter, typename = std::enable_if_t<std::is_pointer_v<typename std::iterator_traits<Iter>::value_type>>>
+	layout_report AnalyzeLayout(Iter first, Iter last, const layout_options& options = {})
+	{
+		using ValueType = std::remove_cv_t<std::remove_pointer_t<typename std::iterator_traits<Iter>::value_type>>;
+		using Category = typename std::iterator_traits<Iter>::iterator_category;
+
+		layout_report report;
+		detail::LayoutAccumulator acc{ report, options, sizeof(ValueType) };
+
+		if constexpr (std::is_base_of_v<std::random_access_iterator_tag, Category>) {
+			const auto count = static_cast<std::size_t>(last - first);
+			if (options.max_samples != 0 && count > 2 * options.max_samples) {
+				report.elements = count;
+				const std::size_t step = count / options.max_samples;
+				for (std::size_t i = 0; i + 1 < count; i += step) {
+					acc.visit(first[i]);
+					acc.visit(first[i + 1]);
+					acc.visit_pair(first[i], first[i + 1]);
+				}
+				acc.finish();
+				return report;
+			}
+		}
+
+		if (first != last) {
+			auto prev = *first;
+			acc.visit(prev);
+			++report.elements;
+			for (++first; first != last; ++first) {
+				auto current = *first;
+				acc.visit(current);
+				acc.visit_pair(prev, current);
+				++report.elements;
+				prev = current;
+			}
+		}
+
+		acc.finish();
+		return report;
+	}
+
+	template<typename Container>
+	layout_report AnalyzeLayout(const Container& container, const layout_options& options = {})
+	{
+		return AnalyzeLayout(std::cbegin(container), std::cend(container), options);
+	}
+}
+
+#endif // !RANGE_OF_POINTERS_LAYOUT_ANALYSIS_HPP
@@ -0,0 +1,158 @@
+#pragma once
+#ifndef RANGE_OF_POINTERS_MAPPED_LOAD_HPP
+#define RANGE_OF_POINTERS_MAPPED_LOAD_HPP
+
+// Zero-copy loading of files written by Serialize (Serialization.hpp): the file is mmap-ed and
+// the pointer container points straight into the mapping, no pointee is copied or allocated.
+// POSIX only.
+
+#include "Serialization.hpp"
+
+#ifdef RANGE_OF_PTRS_HAS_POSIX_IO
+
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+
+namespace range_of_ptrs {
+
+	// Owns one mapping and unmaps it on destruction.
+	class mapped_region {
+	public:
+		mapped_region() = default;
+		mapped_region(void* data, std::size_t size) : data_{ data }, size_{ size } {}
+
+		mapped_region(const mapped_region&) = delete;
+		mapped_region& operator=(const mapped_region&) = delete;
+
+		mapped_region(mapped_region&& other) noexcept : data_{ std::exchange(other.data_, nullptr) }, size_{ std::exchange(other.size_, 0) } {}
+		mapped_region& operator=(mapped_region&& other) noexcept
+		{
+			if (this == &other) return *this;
+			reset();
+			data_ = std::exchange(other.data_, nullptr);
+			size_ = std::exchange(other.size_, 0);
+			return *this;
+		}
+
+		~mapped_region() { reset(); }
+
+		void reset() noexcept
+		{
+			if (data_ != nullptr)
+				::munmap(data_, size_);
+			data_ = nullptr;
+			size_ = 0;
+		}
+
+		const void* data() const noexcept { return data_; }
+		std::size_t size() const noexcept { return size_; }
+		bool empty() const noexcept { return data_ == nullptr; }
+
+	private:
+		void* data_ = nullptr;
+		std::size_t size_ = 0;
+	};
+
+
+	// Counterpart of raii_ptrs_container_wrapper for containers that point into a mapping: the
+	// destructor empties the container, so none of its pointers outlives the mapping, then unmaps
+	// the region instead of deleting the pointees. release() gives the region back and leaves the
+	// container alone.
+	template<typename Container, typename = std::enable_if_t<std::is_pointer_v<typename Container::value_type>>>
+	struct raii_ptrs_mapping_wrapper {
+		raii_ptrs_mapping_wrapper() = default;
+		raii_ptrs_mapping_wrapper(Container& container, mapped_region region) : pCont_{ &container }, region_{ std::move(region) } {}
+		~raii_ptrs_mapping_wrapper() {
+			if (pCont_ != nullptr)
+				pCont_->clear();
+		}
+
+		raii_ptrs_mapping_wrapper(const raii_ptrs_mapping_wrapper&) = delete;
+		raii_ptrs_mapping_wrapper& operator=(const raii_ptrs_mapping_wrapper&) = delete;
+
+		raii_ptrs_mapping_wrapper(raii_ptrs_mapping_wrapper&&) = delete;
+		raii_ptrs_mapping_wrapper& operator=(raii_ptrs_mapping_wrapper&&) = delete;
+
+		void change_container(Container& container) { pCont_ = &container; }
+		mapped_region release() { pCont_ = nullptr; return std::move(region_); }
+
+	private:
+		Container* pCont_ = nullptr;
+		mapped_region region_;
+	};
+
+
+	// Maps the file at `path` and returns pointers to its objects; `region` receives the mapping.
+	// Containers of `const T*` map the file read-only. Containers of `T*` map it copy-on-write
+	// (MAP_PRIVATE), so pointees can be modified without touching the file and only the written
+	// pages get copied. With `populate` all pages are faulted in up front.
+	template<typename Container>
+	Container MapSerialized(const char* path, mapped_region& region, bool populate = false)
+	{
+		using PointeeType = std::remove_pointer_t<typename Container::value_type>;
+		using ValueType = std::remove_cv_t<PointeeType>;
+		static_assert(std::is_trivially_copyable_v<ValueType>, "MapSerialized requires trivially copyable pointees");
+
+		const int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+		if (fd < 0)
+			throw std::system_error(errno, std::generic_category(), path);
+
+		struct stat info {};
+		if (::fstat(fd, &info) != 0) {
+			const int error = errno;
+			::close(fd);
+			throw std::system_error(error, std::generic_category(), path);
+		}
+
+		const auto fileSize = static_cast<std::size_t>(info.st_size);
+		if (fileSize < sizeof(serialized_header)) {
+			::close(fd);
+			throw std::runtime_error("range_of_ptrs: file too small for a serialized pointer range");
+		}
+
+		const int protection = std::is_const_v<PointeeType> ? PROT_READ : PROT_READ | PROT_WRITE;
+		int flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+		if (populate) flags |= MAP_POPULATE;
+#else
+		(void)populate;
+#endif
+		void* data = ::mmap(nullptr, fileSize, protection, flags, fd, 0);
+		const int error = errno;
+		::close(fd);
+		if (data == MAP_FAILED)
+			throw std::system_error(error, std::generic_category(), path);
+
+		mapped_region mapping{ data, fileSize };
+
+		serialized_header header;
+		std::memcpy(&header, data, sizeof(header));
+		ValidateSerializedHeader<ValueType>(header);
+		if (header.data_offset > fileSize || header.count > (fileSize - header.data_offset) / sizeof(ValueType))
+			throw std::runtime_error("range_of_ptrs: serialized pointer range is truncated");
+
+		auto objects = reinterpret_cast<PointeeType*>(static_cast<char*>(data) + header.data_offset);
+		const auto count = static_cast<std::size_t>(header.count);
+
+		Container result;
+		result.reserve(count);
+		for (std::size_t i = 0; i < count; ++i)
+			result.push_back(objects + i);
+
+		region = std::move(mapping);
+		return result;
+	}
+}
+
+#endif // RANGE_OF_PTRS_HAS_POSIX_IO
+
+#endif // !RANGE_OF_POINTERS_MAPPED_LOAD_HPP
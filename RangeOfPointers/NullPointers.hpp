@@ -0,0 +1,281 @@
+#pragma once
+#ifndef RANGE_OF_POINTERS_NULL_POINTERS_HPP
+#define RANGE_OF_POINTERS_NULL_POINTERS_HPP
+
+// Ranges that carry nullptr slots, e.g. left behind by Remove and Unique.
+//
+// CountNulls and CompactNulls scan contiguous pointer arrays (raw pointers, std::vector iterators)
+// with AVX-512 or AVX2 when the compiler targets them (RANGE_OF_PTRS_NATIVE) and with a branchless
+// scalar loop otherwise.
+//
+// The algorithms also take a null policy as the first argument: assume_non_null keeps the plain
+// behaviour (nulls are a precondition violation), may_contain_nulls skips the null slots.
+
+#include "RangeOfPointers.hpp"
+#include "Bits.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <type_traits>
+#include <vector>
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+
+namespace range_of_ptrs {
+
+	struct assume_non_null_t { explicit assume_non_null_t() = default; };
+	struct may_contain_nulls_t { explicit may_contain_nulls_t() = default; };
+
+	inline constexpr assume_non_null_t assume_non_null{};
+	inline constexpr may_contain_nulls_t may_contain_nulls{};
+
+	namespace detail {
+		// Iterators over contiguous pointer storage whose elements can be read as a plain array.
+		template<typename Iter>
+		constexpr bool IsContiguousPtrIter()
+		{
+			using PtrType = typename std::iterator_traits<Iter>::value_type;
+			if constexpr (!std::is_pointer_v<PtrType>)
+				return false;
+			else
+				return std::is_pointer_v<Iter>
+					|| std::is_same_v<Iter, typename std::vector<PtrType>::iterator>
+					|| std::is_same_v<Iter, typename std::vector<PtrType>::const_iterator>;
+		}
+
+#if defined(__AVX2__) && !defined(__AVX512F__)
+		// For every 4-bit mask of non-null lanes, the 32-bit lane indices that move those 64-bit lanes to the front.
+		struct compact_permutations {
+			constexpr compact_permutations() : table{}
+			{
+				for (int mask = 0; mask < 16; ++mask) {
+					int out = 0;
+					for (int lane = 0; lane < 4; ++lane) {
+						if ((mask >> lane) & 1) {
+							table[mask][out * 2] = lane * 2;
+							table[mask][out * 2 + 1] = lane * 2 + 1;
+							++out;
+						}
+					}
+				}
+			}
+			alignas(32) std::int32_t table[16][8];
+		};
+		inline constexpr compact_permutations compactPermutations{};
+#endif
+
+		template<typename PtrType>
+		std::size_t CountNullsContiguous(const PtrType* data, std::size_t size) noexcept
+		{
+			std::size_t count = 0;
+			std::size_t i = 0;
+#if defined(__AVX512F__)
+			if constexpr (sizeof(PtrType) == 8) {
+				for (const std::size_t vectorEnd = size - size % 8; i != vectorEnd; i += 8) {
+					const __m512i lanes = _mm512_loadu_si512(data + i);
+					count += 8 - PopCount64(_mm512_test_epi64_mask(lanes, lanes));
+				}
+			}
+#elif defined(__AVX2__)
+			if constexpr (sizeof(PtrType) == 8) {
+				for (const std::size_t vectorEnd = size - size % 4; i != vectorEnd; i += 4) {
+					const __m256i lanes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+					const __m256i nulls = _mm256_cmpeq_epi64(lanes, _mm256_setzero_si256());
+					count += PopCount64(static_cast<unsigned>(_mm256_movemask_pd(_mm256_castsi256_pd(nulls))));
+				}
+			}
+#endif
+			for (const PtrType* from = data + i; from != data + size; ++from)
+				count += *from == nullptr;
+			return count;
+		}
+
+		// Moves the non-null pointers to the front keeping their order and returns how many there are.
+		template<typename PtrType>
+		std::size_t CompactNullsContiguous(PtrType* data, std::size_t size) noexcept
+		{
+			std::size_t out = 0;
+			std::size_t i = 0;
+			// The vector stores write at `out` <= i, into lanes that were already loaded.
+#if defined(__AVX512F__)
+			if constexpr (sizeof(PtrType) == 8) {
+				for (const std::size_t vectorEnd = size - size % 8; i != vectorEnd; i += 8) {
+					const __m512i lanes = _mm512_loadu_si512(data + i);
+					const __mmask8 keep = _mm512_test_epi64_mask(lanes, lanes);
+					_mm512_mask_compressstoreu_epi64(data + out, keep, lanes);
+					out += PopCount64(keep);
+				}
+			}
+#elif defined(__AVX2__)
+			if constexpr (sizeof(PtrType) == 8) {
+				for (const std::size_t vectorEnd = size - size % 4; i != vectorEnd; i += 4) {
+					const __m256i lanes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+					const __m256i nulls = _mm256_cmpeq_epi64(lanes, _mm256_setzero_si256());
+					const unsigned keep = ~static_cast<unsigned>(_mm256_movemask_pd(_mm256_castsi256_pd(nulls))) & 0xF;
+					const __m256i permutation = _mm256_load_si256(reinterpret_cast<const __m256i*>(compactPermutations.table[keep]));
+					_mm256_storeu_si256(reinterpret_cast<__m256i*>(data + out), _mm256_permutevar8x32_epi32(lanes, permutation));
+					out += PopCount64(keep);
+				}
+			}
+#endif
+			for (; i < size; ++i) {
+				PtrType ptr = data[i];
+				data[out] = ptr;
+				out += ptr != nullptr;
+			}
+			return out;
+		}
+	}
+
+
+	template<typename InIter>
+	typename std::iterator_traits<InIter>::difference_type CountNulls(InIter first, InIter last)
+	{
+		RANGE_OF_PTRS_PERF_SCOPE("CountNulls", detail::PerfRangeSize(first, last));
+		if constexpr (detail::IsContiguousPtrIter<InIter>()) {
+			if (first == last) return 0;
+			return static_cast<typename std::iterator_traits<InIter>::difference_type>(
+				detail::CountNullsContiguous(&*first, static_cast<std::size_t>(last - first)));
+		}
+		else {
+			typename std::iterator_traits<InIter>::difference_type count = 0;
+			for (; first != last; ++first)
+				count += *first == nullptr;
+			return count;
+		}
+	}
+
+	// Moves the non-null pointers to the front keeping their order, sets the rest of the range
+	// to nullptr and returns the end of the non-null part. Nothing is deleted.
+	template<typename ForwardIt>
+	ForwardIt CompactNulls(ForwardIt first, ForwardIt last)
+	{
+		RANGE_OF_PTRS_PERF_SCOPE("CompactNulls", detail::PerfRangeSize(first, last));
+		ForwardIt result = first;
+		if constexpr (detail::IsContiguousPtrIter<ForwardIt>()) {
+			if (first == last) return last;
+			result = first + static_cast<typename std::iterator_traits<ForwardIt>::difference_type>(
+				detail::CompactNullsContiguous(&*first, static_cast<std::size_t>(last - first)));
+		}
+		else {
+			for (; first != last; ++first) {
+				if (*first != nullptr) {
+					*result = *first;
+					++result;
+				}
+			}
+		}
+		std::fill(result, last, nullptr);
+		return result;
+	}
+
+
+	// assume_non_null: the plain algorithms.
+
+	template<typename InIter, typename OutIter, typename Pred>
+	OutIter CopyIf(assume_non_null_t, InIter first, InIter last, OutIter dest, Pred pred) { return CopyIf(first, last, dest, pred); }
+
+	template<typename InIter, typename OutIter, typename Pred>
+	OutIter CloneIf(assume_non_null_t, InIter first, InIter last, OutIter dest, Pred pred) { return CloneIf(first, last, dest, pred); }
+
+	template<typename ForwardIt, typename T>
+	ForwardIt Remove(assume_non_null_t, ForwardIt first, ForwardIt last, const T& value) { return Remove(first, last, value); }
+
+	template<typename ForwardIt, typename T, typename Predicate>
+	ForwardIt RemoveIf(assume_non_null_t, ForwardIt first, ForwardIt last, const T& value, Predicate pred) { return RemoveIf(first, last, value, pred); }
+
+	template<typename ForwardIt>
+	ForwardIt Unique(assume_non_null_t, ForwardIt first, ForwardIt last) { return Unique(first, last); }
+
+	template<typename ForwardIt, typename BinaryPredicate>
+	ForwardIt Unique(assume_non_null_t, ForwardIt first, ForwardIt last, BinaryPredicate pred) { return Unique(first, last, pred); }
+
+	template<typename ToContainer, typename It>
+	ToContainer DeepCopyOfRange(assume_non_null_t, It first, It last) { return DeepCopyOfRange<ToContainer>(first, last); }
+
+
+	// may_contain_nulls: null sources are skipped by the copying algorithms. The removing ones
+	// compact the nulls away first, so the result range holds no null and everything after it is null
+	// or a moved-from slot, as with the plain versions.
+
+	template<typename InIter, typename OutIter, typename Pred>
+	OutIter CopyIf(may_contain_nulls_t, InIter first, InIter last, OutIter dest, Pred pred)
+	{
+		RANGE_OF_PTRS_PERF_SCOPE("CopyIf", detail::PerfRangeSize(first, last));
+		for (; first != last; ++first) {
+			const auto ptr = *first;
+			if (ptr != nullptr && pred(*ptr)) {
+				assert(*dest != nullptr);
+				*(*dest) = *ptr;
+				++dest;
+			}
+		}
+		return dest;
+	}
+
+	template<typename InIter, typename OutIter, typename Pred>
+	OutIter CloneIf(may_contain_nulls_t, InIter first, InIter last, OutIter dest, Pred pred)
+	{
+		RANGE_OF_PTRS_PERF_SCOPE("CloneIf", detail::PerfRangeSize(first, last));
+		for (; first != last; ++first) {
+			const auto ptr = *first;
+			if (ptr != nullptr && pred(*ptr)) {
+				detail::WriteOwned(dest, RANGE_OF_PTRS_ADOPT(ptr->Clone(), "CloneIf"));
+				++dest;
+			}
+		}
+		return dest;
+	}
+
+	template<typename ForwardIt, typename T>
+	ForwardIt Remove(may_contain_nulls_t, ForwardIt first, ForwardIt last, const T& value)
+	{
+		return Remove(first, CompactNulls(first, last), value);
+	}
+
+	template<typename ForwardIt, typename T, typename Predicate>
+	ForwardIt RemoveIf(may_contain_nulls_t, ForwardIt first, ForwardIt last, const T& value, Predicate pred)
+	{
+		return RemoveIf(first, CompactNulls(first, last), value, pred);
+	}
+
+	template<typename ForwardIt>
+	ForwardIt Unique(may_contain_nulls_t, ForwardIt first, ForwardIt last)
+	{
+		return Unique(first, CompactNulls(first, last));
+	}
+
+	template<typename ForwardIt, typename BinaryPredicate>
+	ForwardIt Unique(may_contain_nulls_t, ForwardIt first, ForwardIt last, BinaryPredicate pred)
+	{
+		return Unique(first, CompactNulls(first, last), pred);
+	}
+
+	// Deep copies of the non-null pointees only.
+	template<typename ToContainer, typename It>
+	ToContainer DeepCopyOfRange(may_contain_nulls_t, It first, It last)
+	{
+		RANGE_OF_PTRS_PERF_SCOPE("DeepCopyOfRange", detail::PerfRangeSize(first, last));
+		using ValueType = std::remove_pointer_t<typename std::iterator_traits<It>::value_type>;
+
+		ToContainer result;
+		raii_ptrs_container_wrapper<ToContainer> backout{ result };
+
+		if constexpr (detail::IsRandomAccessIter<It>())
+			result.reserve(static_cast<std::size_t>((last - first) - CountNulls(first, last)));
+		for (; first != last; ++first) {
+			if (*first != nullptr)
+				result.push_back(RANGE_OF_PTRS_ADOPT(new ValueType(*(*first)), "DeepCopyOfRange"));
+		}
+
+		backout.release();
+		return result;
+	}
+}
+
+#endif // !RANGE_OF_POINTERS_NULL_POINTERS_HPP
@@ -0,0 +1,340 @@
+#pragma once
+#ifndef RANGE_OF_POINTERS_OWNERSHIP_TRACKER_HPP
+#define RANGE_OF_POINTERS_OWNERSHIP_TRACKER_HPP
+
+// Debug registry of owned pointees, compiled in only when RANGE_OF_PTRS_OWNERSHIP_TRACKING
+// is defined (never define it in release builds).
+//
+// Every pointee allocated by an algorithm (Clone*, ReplaceClone*, DeepCopy*) is adopted by
+// the registry and every delete performed by an algorithm or an ownership wrapper goes
+// through it. Objects allocated by user code are registered with RANGE_OF_PTRS_TRACK(ptr).
+// The registry reports:
+//   - double deletes (a delete of an address in the quarantine of recently deleted pointees),
+//   - dangling duplicates (a range handed to a wrapper holds the same pointer twice or a
+//     pointer that was already deleted),
+//   - leaks (tracked pointees still alive when check_leaks() is called).
+// The registry only holds the live pointees and the last quarantineCapacity deleted addresses.
+// Deletes of pointers it has never seen are allowed and only counted. A pointer allocated by
+// untracked code at a quarantined address is still reported as a double delete, so the report
+// is a suspicion and by default the delete goes ahead. Track all owning allocations to avoid
+// such reports. With RANGE_OF_PTRS_OWNERSHIP_SKIP_DOUBLE_DELETE also defined, reported double
+// deletes are skipped instead, so a staging run survives them to report the rest; an untracked
+// object at a quarantined address then leaks.
+//
+// Events carry the algorithm name and the innermost RANGE_OF_PTRS_OWNERSHIP_SITE() of the
+// calling thread, which callers place in front of the algorithm calls they want attributed.
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+
+namespace range_of_ptrs::ownership {
+
+	struct call_site {
+		const char* file = nullptr;
+		int line = 0;
+		const char* function = nullptr;
+	};
+
+	enum class violation_kind {
+		double_delete,
+		dangling_duplicate,
+		dangling_pointer,
+		leak
+	};
+
+	inline const char* to_string(violation_kind kind)
+	{
+		switch (kind) {
+		case violation_kind::double_delete: return "double delete";
+		case violation_kind::dangling_duplicate: return "dangling duplicate";
+		case violation_kind::dangling_pointer: return "dangling pointer";
+		case violation_kind::leak: return "leak";
+		}
+		return "";
+	}
+
+	struct violation {
+		violation_kind kind = violation_kind::leak;
+		const void* ptr = nullptr;
+		const char* algorithm = nullptr;    // algorithm that observed the violation
+		call_site site;                     // where the violation happened
+		const char* origin_algorithm = nullptr;
+		call_site origin;                   // where the pointee was allocated or tracked
+		const char* deleted_by = nullptr;   // first delete, for double deletes and dangling pointers
+		call_site deleted_at;
+	};
+
+	inline std::ostream& operator<<(std::ostream& os, const call_site& site)
+	{
+		if (site.file == nullptr) return os << "<unknown site>";
+		return os << site.file << ':' << site.line << " (" << site.function << ')';
+	}
+
+	inline std::ostream& operator<<(std::ostream& os, const violation& v)
+	{
+		os << "[range_of_ptrs] " << to_string(v.kind) << " of " << v.ptr;
+		if (v.kind != violation_kind::leak) {
+			if (v.algorithm != nullptr) os << " in " << v.algorithm;
+			os << " at " << v.site << ';';
+		}
+		os << " allocated";
+		if (v.origin_algorithm != nullptr) os << " by " << v.origin_algorithm;
+		os << " at " << v.origin;
+		if (v.kind == violation_kind::double_delete || v.kind == violation_kind::dangling_pointer) {
+			os << "; first deleted";
+			if (v.deleted_by != nullptr) os << " by " << v.deleted_by;
+			os << " at " << v.deleted_at;
+		}
+		return os;
+	}
+
+
+	namespace detail {
+
+		struct entry {
+			const char* algorithm = nullptr;
+			call_site origin;
+			const char* deleted_by = nullptr;
+			call_site deleted_at;
+			std::uint64_t freed_seq = 0;        // position in the quarantine, for deleted pointees
+		};
+
+		inline const call_site*& current_site()
+		{
+			thread_local const call_site* site = nullptr;
+			return site;
+		}
+
+		struct registry {
+			static constexpr std::size_t quarantineCapacity = 4096;
+#ifdef RANGE_OF_PTRS_OWNERSHIP_SKIP_DOUBLE_DELETE
+			static constexpr bool skipDoubleDelete = true;
+#else
+			static constexpr bool skipDoubleDelete = false;
+#endif
+
+			void adopt(const void* ptr, const char* algorithm, const call_site& origin)
+			{
+				if (ptr == nullptr) return;
+				std::lock_guard<std::mutex> lock{ mutex_ };
+				freed_.erase(ptr);   // the address was reused
+				entries_[ptr] = entry{ algorithm, origin, nullptr, {} };
+			}
+
+			// Called before every delete; returns whether the delete must go ahead. Only a reported
+			// double delete with skipDoubleDelete returns false, and its address stays quarantined.
+			bool release(const void* ptr, const char* algorithm)
+			{
+				if (ptr == nullptr) return true;
+
+				std::unique_lock<std::mutex> lock{ mutex_ };
+				if (auto it = entries_.find(ptr); it != entries_.end()) {
+					entry info = it->second;
+					entries_.erase(it);
+					info.deleted_by = algorithm;
+					info.deleted_at = site_or_empty();
+					quarantine(ptr, info);
+					return true;
+				}
+
+				auto it = freed_.find(ptr);
+				if (it == freed_.end()) {
+					++untracked_deletes_;
+					return true;
+				}
+
+				const violation v = make_violation(violation_kind::double_delete, ptr, algorithm, it->second);
+				if (!skipDoubleDelete)
+					freed_.erase(it);
+				lock.unlock();
+				report(v);
+				return !skipDoubleDelete;
+			}
+
+			template<typename Iter>
+			void check_range(Iter first, Iter last, const char* algorithm)
+			{
+				std::vector<violation> found;
+				{
+					std::lock_guard<std::mutex> lock{ mutex_ };
+					std::unordered_set<const void*> seen;
+					for (; first != last; ++first) {
+						const void* ptr = *first;
+						if (ptr == nullptr) continue;
+
+						const auto live = entries_.find(ptr);
+						const auto freed = live == entries_.end() ? freed_.find(ptr) : freed_.end();
+						const entry info = live != entries_.end() ? live->second : freed != freed_.end() ? freed->second : entry{};
+						if (!seen.insert(ptr).second)
+							found.push_back(make_violation(violation_kind::dangling_duplicate, ptr, algorithm, info));
+						else if (freed != freed_.end())
+							found.push_back(make_violation(violation_kind::dangling_pointer, ptr, algorithm, info));
+					}
+				}
+				for (const auto& v : found)
+					report(v);
+			}
+
+			std::vector<violation> check_leaks()
+			{
+				std::vector<violation> found;
+				{
+					std::lock_guard<std::mutex> lock{ mutex_ };
+					for (const auto& [ptr, info] : entries_)
+						found.push_back(make_violation(violation_kind::leak, ptr, nullptr, info));
+				}
+				for (const auto& v : found)
+					report(v);
+				return found;
+			}
+
+			std::size_t live_count() const
+			{
+				std::lock_guard<std::mutex> lock{ mutex_ };
+				return entries_.size();
+			}
+
+			std::size_t untracked_deletes() const
+			{
+				std::lock_guard<std::mutex> lock{ mutex_ };
+				return untracked_deletes_;
+			}
+
+			std::vector<violation> violations() const
+			{
+				std::lock_guard<std::mutex> lock{ mutex_ };
+				return violations_;
+			}
+
+			void set_handler(std::function<void(const violation&)> handler)
+			{
+				std::lock_guard<std::mutex> lock{ mutex_ };
+				handler_ = std::move(handler);
+			}
+
+			void reset()
+			{
+				std::lock_guard<std::mutex> lock{ mutex_ };
+				entries_.clear();
+				freed_.clear();
+				freedOrder_.clear();
+				violations_.clear();
+				untracked_deletes_ = 0;
+			}
+
+		private:
+			// Keeps the last quarantineCapacity deleted addresses. freedOrder_ may hold addresses
+			// that were reused or reported since; their sequence numbers no longer match.
+			void quarantine(const void* ptr, entry info)
+			{
+				info.freed_seq = ++freedSeq_;
+				freed_[ptr] = info;
+				freedOrder_.emplace_back(ptr, info.freed_seq);
+				if (freedOrder_.size() > quarantineCapacity) {
+					const auto [oldest, seq] = freedOrder_.front();
+					freedOrder_.pop_front();
+					if (auto it = freed_.find(oldest); it != freed_.end() && it->second.freed_seq == seq)
+						freed_.erase(it);
+				}
+			}
+
+			static call_site site_or_empty()
+			{
+				const call_site* site = current_site();
+				return site == nullptr ? call_site{} : *site;
+			}
+
+			static violation make_violation(violation_kind kind, const void* ptr, const char* algorithm, const entry& info)
+			{
+				return violation{ kind, ptr, algorithm, site_or_empty(), info.algorithm, info.origin, info.deleted_by, info.deleted_at };
+			}
+
+			void report(const violation& v)
+			{
+				std::function<void(const violation&)> handler;
+				{
+					std::lock_guard<std::mutex> lock{ mutex_ };
+					violations_.push_back(v);
+					handler = handler_;
+				}
+				if (handler)
+					handler(v);
+				else
+					std::cerr << v << std::endl;
+			}
+
+			mutable std::mutex mutex_;
+			std::unordered_map<const void*, entry> entries_;    // live pointees
+			std::unordered_map<const void*, entry> freed_;      // quarantined deleted pointees
+			std::deque<std::pair<const void*, std::uint64_t>> freedOrder_;
+			std::uint64_t freedSeq_ = 0;
+			std::vector<violation> violations_;
+			std::function<void(const violation&)> handler_;
+			std::size_t untracked_deletes_ = 0;
+		};
+
+		inline registry& global_registry()
+		{
+			static registry instance;
+			return instance;
+		}
+
+		template<typename T>
+		T* Adopt(T* ptr, const char* algorithm)
+		{
+			const call_site* site = current_site();
+			global_registry().adopt(ptr, algorithm, site == nullptr ? call_site{} : *site);
+			return ptr;
+		}
+
+		template<typename T>
+		T* Track(T* ptr, const call_site& site)
+		{
+			global_registry().adopt(ptr, nullptr, site);
+			return ptr;
+		}
+
+		template<typename T>
+		void Delete(T* ptr, const char* algorithm)
+		{
+			if (global_registry().release(ptr, algorithm))
+				delete ptr;
+		}
+	}
+
+
+	// Attributes the ownership events of the calling thread to a call site while alive.
+	struct site_scope {
+		explicit site_scope(const call_site& site) : site_{ site }, previous_{ detail::current_site() } { detail::current_site() = &site_; }
+		~site_scope() { detail::current_site() = previous_; }
+
+		site_scope(const site_scope&) = delete;
+		site_scope& operator=(const site_scope&) = delete;
+
+	private:
+		call_site site_;
+		const call_site* previous_;
+	};
+
+
+	inline void set_handler(std::function<void(const violation&)> handler) { detail::global_registry().set_handler(std::move(handler)); }
+	inline std::vector<violation> violations() { return detail::global_registry().violations(); }
+	inline std::vector<violation> check_leaks() { return detail::global_registry().check_leaks(); }
+	inline std::size_t live_count() { return detail::global_registry().live_count(); }
+	inline std::size_t untracked_deletes() { return detail::global_registry().untracked_deletes(); }
+	inline void reset() { detail::global_registry().reset(); }
+
+	template<typename Iter>
+	void check_range(Iter first, Iter last) { detail::global_registry().check_range(first, last, nullptr); }
+}
+
+#endif // !RANGE_OF_POINTERS_OWNERSHIP_TRACKER_HPP
@@ -0,0 +1,79 @@
+#pragma once
+#ifndef RANGE_OF_POINTERS_PARALLEL_HPP
+#define RANGE_OF_POINTERS_PARALLEL_HPP
+
+// Fork/join helper shared by the containers and algorithms that split their work over threads.
+
+#include <cstddef>
+#include <exception>
+#include <thread>
+#include <utility>
+#include <vector>
+
+
+namespace range_of_ptrs {
+
+	namespace detail {
+		// Joins every started worker when it goes out of scope, so a throwing std::thread
+		// constructor or vector growth never destroys a joinable thread.
+		class joining_threads {
+		public:
+			joining_threads() = default;
+			joining_threads(const joining_threads&) = delete;
+			joining_threads& operator=(const joining_threads&) = delete;
+			~joining_threads() { join(); }
+
+			void reserve(std::size_t count) { workers_.reserve(count); }
+
+			template<typename Func, typename... Args>
+			void start(Func&& func, Args&&... args)
+			{
+				workers_.emplace_back(std::forward<Func>(func), std::forward<Args>(args)...);
+			}
+
+			void join() noexcept
+			{
+				for (auto& worker : workers_) {
+					if (worker.joinable()) worker.join();
+				}
+			}
+
+		private:
+			std::vector<std::thread> workers_;
+		};
+
+		// func(part) for every part in [0, parts): part 0 on the calling thread, the others on a
+		// thread each. Returns once all parts are done; the first exception thrown by a part is
+		// rethrown then. If a worker cannot be started, the started ones are joined and the
+		// exception is propagated without running the remaining parts.
+		template<typename Func>
+		void ParallelParts(std::size_t parts, Func func)
+		{
+			if (parts == 0) return;
+
+			std::vector<std::exception_ptr> errors(parts);
+			auto runPart = [&](std::size_t part) {
+				try {
+					func(part);
+				}
+				catch (...) {
+					errors[part] = std::current_exception();
+				}
+			};
+
+			{
+				joining_threads workers;
+				workers.reserve(parts - 1);
+				for (std::size_t part = 1; part < parts; ++part)
+					workers.start(runPart, part);
+				runPart(0);
+			}
+
+			for (auto& error : errors) {
+				if (error) std::rethrow_exception(error);
+			}
+		}
+	}
+}
+
+#endif // !RANGE_OF_POINTERS_PARALLEL_HPP
@@ -0,0 +1,260 @@
+#pragma once
+#ifndef RANGE_OF_POINTERS_PERF_COUNTERS_HPP
+#define RANGE_OF_POINTERS_PERF_COUNTERS_HPP
+
+// Hardware performance counters for the algorithms of RangeOfPointers.hpp.
+//
+// Compiled in only when RANGE_OF_PTRS_PERF_COUNTERS is defined; otherwise the
+// RANGE_OF_PTRS_PERF_SCOPE macro used by the algorithms expands to nothing.
+// Counters are read with perf_event_open(2) on Linux (user space only, so the
+// default perf_event_paranoid setting is enough). On other platforms, or when
+// the kernel refuses to open the events, only call counts are collected.
+//
+// Results are aggregated per algorithm name and per input size bucket
+// (floor power of two of the element count).
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+
+namespace range_of_ptrs::perf {
+
+	enum counter : std::size_t {
+		cycles,
+		instructions,
+		l1d_misses,
+		llc_misses,
+		dtlb_misses,
+		branch_misses,
+		counters_count
+	};
+
+	inline const char* counter_name(std::size_t index)
+	{
+		static const char* const names[counters_count] = {
+			"cycles", "instructions", "L1d-misses", "LLC-misses", "dTLB-misses", "branch-misses"
+		};
+		return index < counters_count ? names[index] : "";
+	}
+
+	using counter_values = std::array<std::uint64_t, counters_count>;
+
+	struct record {
+		std::string algorithm;
+		std::size_t size_bucket = 0;
+		std::uint64_t calls = 0;
+		std::uint64_t elements = 0;
+		counter_values totals = {};
+	};
+
+
+	namespace detail {
+
+		inline std::size_t size_bucket(std::size_t size)
+		{
+			if (size == 0) return 0;
+
+			std::size_t bucket = 1;
+			while (bucket <= size / 2)
+				bucket <<= 1;
+			return bucket;
+		}
+
+		// One group of counters per thread, cycles being the group leader.
+		struct thread_counters {
+			thread_counters()
+			{
+#if defined(__linux__)
+				const std::uint64_t cacheMiss = (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+				const std::pair<std::uint32_t, std::uint64_t> events[counters_count] = {
+					{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+					{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+					{ PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | cacheMiss },
+					{ PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL | cacheMiss },
+					{ PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | cacheMiss },
+					{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+				};
+
+				for (std::size_t i = 0; i < counters_count; ++i) {
+					perf_event_attr attr{};
+					attr.size = sizeof(attr);
+					attr.type = events[i].first;
+					attr.config = events[i].second;
+					attr.exclude_kernel = 1;
+					attr.exclude_hv = 1;
+					attr.read_format = PERF_FORMAT_GROUP;
+
+					const int fd = static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, leader_, 0));
+					if (fd < 0) {
+						if (i == 0) return;
+						continue;
+					}
+					if (leader_ < 0) leader_ = fd;
+					fds_.push_back(fd);
+					slots_.push_back(i);
+				}
+#endif
+			}
+
+			~thread_counters()
+			{
+#if defined(__linux__)
+				for (int fd : fds_)
+					::close(fd);
+#endif
+			}
+
+			thread_counters(const thread_counters&) = delete;
+			thread_counters& operator=(const thread_counters&) = delete;
+
+			bool available() const noexcept { return leader_ >= 0; }
+
+			counter_values read() const
+			{
+				counter_values result = {};
+#if defined(__linux__)
+				if (!available()) return result;
+
+				std::uint64_t buffer[1 + counters_count] = {};
+				if (::read(leader_, buffer, sizeof(buffer)) <= 0) return result;
+
+				const std::size_t count = std::min<std::size_t>(buffer[0], slots_.size());
+				for (std::size_t i = 0; i < count; ++i)
+					result[slots_[i]] = buffer[1 + i];
+#endif
+				return result;
+			}
+
+		private:
+			int leader_ = -1;
+			std::vector<int> fds_;
+			std::vector<std::size_t> slots_;
+		};
+
+		inline thread_counters& this_thread_counters()
+		{
+			thread_local thread_counters counters;
+			return counters;
+		}
+
+		struct registry {
+			void add(const char* algorithm, std::size_t size, const counter_values& delta)
+			{
+				std::lock_guard<std::mutex> lock{ mutex_ };
+				auto& rec = records_[{ algorithm, size_bucket(size) }];
+				++rec.calls;
+				rec.elements += size;
+				for (std::size_t i = 0; i < counters_count; ++i)
+					rec.totals[i] += delta[i];
+			}
+
+			std::vector<record> snapshot() const
+			{
+				std::lock_guard<std::mutex> lock{ mutex_ };
+				std::vector<record> result;
+				result.reserve(records_.size());
+				for (const auto& [key, rec] : records_) {
+					result.push_back(rec);
+					result.back().algorithm = key.first;
+					result.back().size_bucket = key.second;
+				}
+				return result;
+			}
+
+			void reset()
+			{
+				std::lock_guard<std::mutex> lock{ mutex_ };
+				records_.clear();
+			}
+
+		private:
+			mutable std::mutex mutex_;
+			std::map<std::pair<std::string, std::size_t>, record> records_;
+		};
+
+		inline registry& global_registry()
+		{
+			static registry instance;
+			return instance;
+		}
+	}
+
+
+	// Reads the counters of the calling thread on construction and on destruction
+	// and adds the difference to the global registry.
+	struct scope {
+		scope(const char* algorithm, std::size_t size)
+			: algorithm_{ algorithm }, size_{ size }, start_{ detail::this_thread_counters().read() } {}
+
+		~scope()
+		{
+			const counter_values finish = detail::this_thread_counters().read();
+			counter_values delta = {};
+			for (std::size_t i = 0; i < counters_count; ++i)
+				delta[i] = finish[i] - start_[i];
+			detail::global_registry().add(algorithm_, size_, delta);
+		}
+
+		scope(const scope&) = delete;
+		scope& operator=(const scope&) = delete;
+
+	private:
+		const char* algorithm_;
+		std::size_t size_;
+		counter_values start_;
+	};
+
+
+	inline bool available() { return detail::this_thread_counters().available(); }
+	inline std::vector<record> snapshot() { return detail::global_registry().snapshot(); }
+	inline void reset() { detail::global_registry().reset(); }
+
+	// Prints one line per algorithm and size bucket with per element averages.
+	inline void report(std::ostream& os)
+	{
+		os << "algorithm size_bucket calls";
+		for (std::size_t i = 0; i < counters_count; ++i)
+			os << ' ' << counter_name(i) << "/elem";
+		os << '\n';
+
+		for (const auto& rec : snapshot()) {
+			os << rec.algorithm << ' ' << rec.size_bucket << ' ' << rec.calls;
+			const double elements = rec.elements == 0 ? 1.0 : static_cast<double>(rec.elements);
+			for (std::size_t i = 0; i < counters_count; ++i)
+				os << ' ' << static_cast<double>(rec.totals[i]) / elements;
+			os << '\n';
+		}
+	}
+}
+
+
+namespace range_of_ptrs::detail {
+
+	template<typename Iter>
+	std::size_t PerfRangeSize(Iter first, Iter last)
+	{
+		using Category = typename std::iterator_traits<Iter>::iterator_category;
+		if constexpr (std::is_base_of_v<std::forward_iterator_tag, Category>)
+			return static_cast<std::size_t>(std::distance(first, last));
+		else
+			return 0;
+	}
+}
+
+#endif // !RANGE_OF_POINTERS_PERF_COUNTERS_HPP
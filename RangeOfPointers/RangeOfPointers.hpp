@@ -5,8 +5,40 @@
 #include <type_traits>
 #include <algorithm>
 #include <cassert>
+#include <cstddef>
 #include <iterator>
-
+#include <new>
+
+#if defined(_MSC_VER) && !defined(__clang__) && (defined(_M_X64) || defined(_M_IX86))
+#include <xmmintrin.h>
+#endif
+
+#ifdef RANGE_OF_PTRS_PERF_COUNTERS
+#include "PerfCounters.hpp"
+#define RANGE_OF_PTRS_PERF_SCOPE(name, size) ::range_of_ptrs::perf::scope rangeOfPtrsPerfScope{ name, static_cast<std::size_t>(size) }
+#else
+#define RANGE_OF_PTRS_PERF_SCOPE(name, size)
+#endif
+
+#ifdef RANGE_OF_PTRS_OWNERSHIP_TRACKING
+#include "OwnershipTracker.hpp"
+#define RANGE_OF_PTRS_DELETE(ptr, name) ::range_of_ptrs::ownership::detail::Delete(ptr, name)
+#define RANGE_OF_PTRS_ADOPT(ptr, name) ::range_of_ptrs::ownership::detail::Adopt(ptr, name)
+#define RANGE_OF_PTRS_CHECK_RANGE(first, last, name) ::range_of_ptrs::ownership::detail::global_registry().check_range(first, last, name)
+#define RANGE_OF_PTRS_TRACK(ptr) ::range_of_ptrs::ownership::detail::Track(ptr, ::range_of_ptrs::ownership::call_site{ __FILE__, __LINE__, __func__ })
+#define RANGE_OF_PTRS_OWNERSHIP_SITE() ::range_of_ptrs::ownership::site_scope rangeOfPtrsOwnershipSite{ ::range_of_ptrs::ownership::call_site{ __FILE__, __LINE__, __func__ } }
+#else
+#define RANGE_OF_PTRS_DELETE(ptr, name) delete (ptr)
+#define RANGE_OF_PTRS_ADOPT(ptr, name) (ptr)
+#define RANGE_OF_PTRS_CHECK_RANGE(first, last, name)
+#define RANGE_OF_PTRS_TRACK(ptr) (ptr)
+#define RANGE_OF_PTRS_OWNERSHIP_SITE()
+#endif
+
+// Elements per block of the pipelined random access loops (Copy, ReplaceCopy, Clone, ...).
+#ifndef RANGE_OF_PTRS_PIPELINE_BLOCK
+#define RANGE_OF_PTRS_PIPELINE_BLOCK 8
+#endif
 
 namespace range_of_ptrs {
 
@@ -29,8 +61,9 @@ namespace range_of_ptrs {
 		raii_ptrs_range_wrapper& operator=(raii_ptrs_range_wrapper&&) = delete;
 
 		~raii_ptrs_range_wrapper() {
+			RANGE_OF_PTRS_CHECK_RANGE(first_, last_, "raii_ptrs_range_wrapper");
 			for (; first_ != last_; ++first_) {
-				delete(*first_);
+				RANGE_OF_PTRS_DELETE(*first_, "raii_ptrs_range_wrapper");
 			}
 		}
 
@@ -53,8 +86,9 @@ namespace range_of_ptrs {
 		explicit raii_ptrs_container_wrapper(const Container& container) : pCont_{ &container } {}
 		~raii_ptrs_container_wrapper() {
 			if (pCont_ == nullptr) return;
+			RANGE_OF_PTRS_CHECK_RANGE(std::begin(*pCont_), std::end(*pCont_), "raii_ptrs_container_wrapper");
 			for (auto p : (*pCont_))
-				delete p;
+				RANGE_OF_PTRS_DELETE(p, "raii_ptrs_container_wrapper");
 		}
 
 		raii_ptrs_container_wrapper(const raii_ptrs_container_wrapper&) = delete;
@@ -71,21 +105,107 @@ namespace range_of_ptrs {
 	};
 
 
+	namespace detail {
+		// *dest = ptr for an output iterator that may throw (e.g. std::back_inserter); ptr is deleted if it does.
+		// *dest is never read, so dest may be uninitialized pointer storage.
+		template<typename OutIter, typename T>
+		void WriteOwned(OutIter& dest, T* ptr)
+		{
+			raii_ptrs_range_wrapper<T**> backout{ &ptr, &ptr + 1 };
+			*dest = ptr;
+			backout.release();
+		}
+
+		template<typename Iter>
+		constexpr bool IsRandomAccessIter()
+		{
+			return std::is_base_of_v<std::random_access_iterator_tag, typename std::iterator_traits<Iter>::iterator_category>;
+		}
+
+		template<typename T>
+		inline void PrefetchPointee(const T* ptr) noexcept
+		{
+#if defined(__GNUC__) || defined(__clang__)
+			__builtin_prefetch(ptr);
+#elif defined(_M_X64) || defined(_M_IX86)
+			_mm_prefetch(reinterpret_cast<const char*>(ptr), _MM_HINT_T0);
+#else
+			(void)ptr;
+#endif
+		}
+
+		constexpr std::ptrdiff_t pipelineBlock = RANGE_OF_PTRS_PIPELINE_BLOCK;
+		static_assert(pipelineBlock > 0, "RANGE_OF_PTRS_PIPELINE_BLOCK must be positive");
+
+		// op(first[i], dest[i]) for i in [0, size), software pipelined in blocks of K: while a block
+		// runs, the pointers of the next one are already loaded and their pointees prefetched, so the
+		// cache misses of K elements are in flight together instead of one dependent miss per element.
+		// The destination pointees are prefetched too when op reads or writes them.
+		template<bool TouchDest, std::ptrdiff_t K = pipelineBlock, typename InRandomIt, typename OutRandomIt, typename Op>
+		void PipelinedForEach(InRandomIt first, OutRandomIt dest, std::ptrdiff_t size, Op op)
+		{
+			const auto touch = [&](std::ptrdiff_t from, std::ptrdiff_t to) {
+				for (; from < to; ++from) {
+					PrefetchPointee(first[from]);
+					if constexpr (TouchDest)
+						PrefetchPointee(dest[from]);
+				}
+			};
+
+			touch(0, std::min(K, size));
+			for (std::ptrdiff_t block = 0; block < size; block += K) {
+				const std::ptrdiff_t next = std::min(block + K, size);
+				touch(next, std::min(next + K, size));
+				for (std::ptrdiff_t i = block; i < next; ++i)
+					op(first[i], dest[i]);
+			}
+		}
+
+		template<typename InIter, typename OutIter>
+		constexpr bool CanPipeline()
+		{
+			return IsRandomAccessIter<InIter>() && IsRandomAccessIter<OutIter>();
+		}
+	}
+
+
 	template<typename InIter, typename OutIter>
 	OutIter Copy(InIter first, InIter last, OutIter dest)
 	{
-		for (; first != last; ++dest, ++first) {
-			assert(*dest != nullptr);
-			assert(*first != nullptr);
-			*(*dest) = *(*first);
+		RANGE_OF_PTRS_PERF_SCOPE("Copy", detail::PerfRangeSize(first, last));
+		if constexpr (detail::CanPipeline<InIter, OutIter>()) {
+			const auto size = last - first;
+			detail::PipelinedForEach<true>(first, dest, size, [](auto from, auto to) {
+				assert(to != nullptr);
+				assert(from != nullptr);
+				*to = *from;
+			});
+			return dest + size;
+		}
+		else {
+			for (; first != last; ++dest, ++first) {
+				assert(*dest != nullptr);
+				assert(*first != nullptr);
+				*(*dest) = *(*first);
+			}
+			return dest;
 		}
-		return dest;
 	}
 
 	template<typename InIter, typename SizeType, typename OutIter>
 	OutIter CopyN(InIter first, SizeType count, OutIter dest)
 	{
-		if (count > 0) {
+		RANGE_OF_PTRS_PERF_SCOPE("CopyN", count > 0 ? count : 0);
+		if constexpr (detail::CanPipeline<InIter, OutIter>()) {
+			const auto size = count > 0 ? static_cast<std::ptrdiff_t>(count) : 0;
+			detail::PipelinedForEach<true>(first, dest, size, [](auto from, auto to) {
+				assert(to != nullptr);
+				assert(from != nullptr);
+				*to = *from;
+			});
+			return dest + size;
+		}
+		else if (count > 0) {
 			while (true) {
 				*(*dest) = *(*first);
 				++dest;
@@ -102,19 +222,32 @@ namespace range_of_ptrs {
 	template<typename InIter, typename OutIter>
 	OutIter CopyBackward(InIter first, InIter last, OutIter dest)
 	{
-		while (first != last) {
-			*(*(--dest)) = *(*(--last));
+		RANGE_OF_PTRS_PERF_SCOPE("CopyBackward", detail::PerfRangeSize(first, last));
+		if constexpr (detail::CanPipeline<InIter, OutIter>()) {
+			const auto size = last - first;
+			detail::PipelinedForEach<true>(std::make_reverse_iterator(last), std::make_reverse_iterator(dest), size, [](auto from, auto to) {
+				assert(to != nullptr);
+				assert(from != nullptr);
+				*to = *from;
+			});
+			return dest - size;
+		}
+		else {
+			while (first != last) {
+				*(*(--dest)) = *(*(--last));
+			}
+			return dest;
 		}
-		return dest;
 	}
 
 	template<typename InIter, typename OutIter, typename Pred>
 	OutIter CopyIf(InIter first, InIter last, OutIter dest, Pred pred)
 	{
+		RANGE_OF_PTRS_PERF_SCOPE("CopyIf", detail::PerfRangeSize(first, last));
 		for (; first != last; ++first) {
-			assert(*dest != nullptr);
 			assert(*first != nullptr);
 			if (pred(*(*first))) {
+				assert(*dest != nullptr);
 				*(*dest) = *(*first);
 				++dest;
 			}
@@ -127,21 +260,34 @@ namespace range_of_ptrs {
 	template<typename InIter, typename OutIter>
 	OutIter ReplaceCopy(InIter first, InIter last, OutIter dest)
 	{
+		RANGE_OF_PTRS_PERF_SCOPE("ReplaceCopy", detail::PerfRangeSize(first, last));
 		using ValueType = std::decay_t<decltype(*(*dest))>;
 
-		for (; first != last; ++dest, ++first) {
-			assert(*dest != nullptr);
-			assert(*first != nullptr);
-			(*dest)->~ValueType();
-			::new (*dest) ValueType(*(*first));
+		if constexpr (detail::CanPipeline<InIter, OutIter>()) {
+			const auto size = last - first;
+			detail::PipelinedForEach<true>(first, dest, size, [](auto from, auto to) {
+				assert(to != nullptr);
+				assert(from != nullptr);
+				to->~ValueType();
+				::new (to) ValueType(*from);
+			});
+			return dest + size;
+		}
+		else {
+			for (; first != last; ++dest, ++first) {
+				assert(*dest != nullptr);
+				assert(*first != nullptr);
+				(*dest)->~ValueType();
+				::new (*dest) ValueType(*(*first));
+			}
+			return dest;
 		}
-
-		return dest;
 	}
 
 	template<typename InIter, typename OutIter, typename Pred>
 	OutIter ReplaceCopyIf(InIter first, InIter last, OutIter dest, Pred pred)
 	{
+		RANGE_OF_PTRS_PERF_SCOPE("ReplaceCopyIf", detail::PerfRangeSize(first, last));
 		using ValueType = std::decay_t<decltype(*(*dest))>;
 
 		for (; first != last; ++dest, ++first) {
@@ -160,22 +306,34 @@ namespace range_of_ptrs {
 	template<typename InIter, typename OutIter>
 	OutIter Clone(InIter first, InIter last, OutIter dest)
 	{
-		for (; first != last; ++dest, ++first) {
-			assert(*dest != nullptr);
-			assert(*first != nullptr);
-			*dest = (*first)->Clone();
+		RANGE_OF_PTRS_PERF_SCOPE("Clone", detail::PerfRangeSize(first, last));
+		if constexpr (detail::CanPipeline<InIter, OutIter>()) {
+			const auto size = last - first;
+			detail::PipelinedForEach<false>(first, dest, size, [](auto from, auto& to) {
+				assert(to != nullptr);
+				assert(from != nullptr);
+				to = RANGE_OF_PTRS_ADOPT(from->Clone(), "Clone");
+			});
+			return dest + size;
+		}
+		else {
+			for (; first != last; ++dest, ++first) {
+				assert(*dest != nullptr);
+				assert(*first != nullptr);
+				*dest = RANGE_OF_PTRS_ADOPT((*first)->Clone(), "Clone");
+			}
+			return dest;
 		}
-		return dest;
 	}
 
 	template<typename InIter, typename OutIter, typename Pred>
 	OutIter CloneIf(InIter first, InIter last, OutIter dest, Pred pred)
 	{
+		RANGE_OF_PTRS_PERF_SCOPE("CloneIf", detail::PerfRangeSize(first, last));
 		for (; first != last; ++first) {
-			assert(*dest != nullptr);
 			assert(*first != nullptr);
 			if (pred(*(*first))) {
-				*dest = (*first)->Clone();
+				detail::WriteOwned(dest, RANGE_OF_PTRS_ADOPT((*first)->Clone(), "CloneIf"));
 				++dest;
 			}
 		}
@@ -186,24 +344,38 @@ namespace range_of_ptrs {
 	template<typename InIter, typename OutIter>
 	OutIter ReplaceClone(InIter first, InIter last, OutIter dest)
 	{
-		for (; first != last; ++dest, ++first) {
-			assert(*dest != nullptr);
-			assert(*first != nullptr);
-			delete(*dest);
-			*dest = (*first)->Clone();
+		RANGE_OF_PTRS_PERF_SCOPE("ReplaceClone", detail::PerfRangeSize(first, last));
+		if constexpr (detail::CanPipeline<InIter, OutIter>()) {
+			const auto size = last - first;
+			detail::PipelinedForEach<true>(first, dest, size, [](auto from, auto& to) {
+				assert(to != nullptr);
+				assert(from != nullptr);
+				RANGE_OF_PTRS_DELETE(to, "ReplaceClone");
+				to = RANGE_OF_PTRS_ADOPT(from->Clone(), "ReplaceClone");
+			});
+			return dest + size;
+		}
+		else {
+			for (; first != last; ++dest, ++first) {
+				assert(*dest != nullptr);
+				assert(*first != nullptr);
+				RANGE_OF_PTRS_DELETE(*dest, "ReplaceClone");
+				*dest = RANGE_OF_PTRS_ADOPT((*first)->Clone(), "ReplaceClone");
+			}
+			return dest;
 		}
-		return dest;
 	}
 
 	template<typename InIter, typename OutIter, typename Pred>
 	OutIter ReplaceCloneIf(InIter first, InIter last, OutIter dest, Pred pred)
 	{
+		RANGE_OF_PTRS_PERF_SCOPE("ReplaceCloneIf", detail::PerfRangeSize(first, last));
 		for (; first != last; ++first) {
 			assert(*dest != nullptr);
 			assert(*first != nullptr);
 			if (pred(*(*first))) {
-				delete(*dest);
-				*dest = (*first)->Clone();
+				RANGE_OF_PTRS_DELETE(*dest, "ReplaceCloneIf");
+				*dest = RANGE_OF_PTRS_ADOPT((*first)->Clone(), "ReplaceCloneIf");
 				++dest;
 			}
 		}
@@ -211,9 +383,54 @@ namespace range_of_ptrs {
 	}
 
 
+	// Copy-constructs the pointees of [first, last) into the raw storage the slots point to (an arena,
+	// a pool, ...), one construction per element, and returns the end of the used slots.
+	// If a copy throws, the objects constructed so far are destroyed; the storage stays with the caller.
+	template<typename InIter, typename SlotIter>
+	SlotIter UninitializedCopyToPtrs(InIter first, InIter last, SlotIter slots)
+	{
+		RANGE_OF_PTRS_PERF_SCOPE("UninitializedCopyToPtrs", detail::PerfRangeSize(first, last));
+		using ValueType = std::remove_cv_t<std::remove_pointer_t<typename std::iterator_traits<InIter>::value_type>>;
+
+		SlotIter current = slots;
+		try {
+			for (; first != last; ++first, ++current) {
+				assert(*first != nullptr);
+				assert(*current != nullptr);
+				::new (static_cast<void*>(*current)) ValueType(*(*first));
+			}
+		}
+		catch (...) {
+			for (; slots != current; ++slots)
+				static_cast<ValueType*>(static_cast<void*>(*slots))->~ValueType();
+			throw;
+		}
+		return current;
+	}
+
+	// Stores (*first)->Clone() into uninitialized pointer slots, which are never read.
+	// If a Clone throws, the clones made so far are deleted.
+	template<typename InIter, typename ForwardIt>
+	ForwardIt CloneToNew(InIter first, InIter last, ForwardIt dest)
+	{
+		RANGE_OF_PTRS_PERF_SCOPE("CloneToNew", detail::PerfRangeSize(first, last));
+
+		raii_ptrs_range_wrapper<ForwardIt> backout{ dest };
+		ForwardIt current = dest;
+		for (; first != last; ++first) {
+			assert(*first != nullptr);
+			*current = RANGE_OF_PTRS_ADOPT((*first)->Clone(), "CloneToNew");
+			backout.update_range(dest, ++current);
+		}
+		backout.release();
+		return current;
+	}
+
+
 	template<typename ForwardIt, typename T>
 	ForwardIt Remove(ForwardIt first, ForwardIt last, const T& value)
 	{
+		RANGE_OF_PTRS_PERF_SCOPE("Remove", detail::PerfRangeSize(first, last));
 		ForwardIt result = first;
 		for (; first != last; ++first) {
 			if (!(*(*first) == value)) {
@@ -221,7 +438,7 @@ namespace range_of_ptrs {
 				result++;
 			}
 			else {
-				delete(*first);
+				RANGE_OF_PTRS_DELETE(*first, "Remove");
 				*first = nullptr;
 			}
 		}
@@ -229,8 +446,9 @@ namespace range_of_ptrs {
 	}
 
 	template<typename ForwardIt, typename T, typename Predicate>
-	ForwardIt RemoveIf(ForwardIt first, ForwardIt last, const T& value, Predicate pred)
+	ForwardIt RemoveIf(ForwardIt first, ForwardIt last, [[maybe_unused]] const T& value, Predicate pred)
 	{
+		RANGE_OF_PTRS_PERF_SCOPE("RemoveIf", detail::PerfRangeSize(first, last));
 		ForwardIt result = first;
 		for (; first != last; ++first) {
 			if (!pred(*(*first))) {
@@ -238,7 +456,7 @@ namespace range_of_ptrs {
 				result++;
 			}
 			else {
-				delete(*first);
+				RANGE_OF_PTRS_DELETE(*first, "RemoveIf");
 				*first = nullptr;
 			}
 		}
@@ -249,6 +467,7 @@ namespace range_of_ptrs {
 	template<typename ForwardIt>
 	ForwardIt Unique(ForwardIt first, ForwardIt last)
 	{
+		RANGE_OF_PTRS_PERF_SCOPE("Unique", detail::PerfRangeSize(first, last));
 		if (first == last)
 			return last;
 
@@ -259,7 +478,7 @@ namespace range_of_ptrs {
 				*result = *first;
 			}
 			else {
-				delete(*first);
+				RANGE_OF_PTRS_DELETE(*first, "Unique");
 				*first = nullptr;
 			}
 		}
@@ -270,6 +489,7 @@ namespace range_of_ptrs {
 	template<typename ForwardIt, typename BinaryPredicate>
 	ForwardIt Unique(ForwardIt first, ForwardIt last, BinaryPredicate pred)
 	{
+		RANGE_OF_PTRS_PERF_SCOPE("Unique", detail::PerfRangeSize(first, last));
 		if (first == last)
 			return last;
 
@@ -280,7 +500,7 @@ namespace range_of_ptrs {
 				*result = *first;
 			}
 			else {
-				delete(*first);
+				RANGE_OF_PTRS_DELETE(*first, "Unique");
 				*first = nullptr;
 			}
 		}
@@ -295,15 +515,18 @@ namespace range_of_ptrs {
 	>
 	ToContainer DeepCopyOfRange(It first, It last)
 	{
+		RANGE_OF_PTRS_PERF_SCOPE("DeepCopyOfRange", detail::PerfRangeSize(first, last));
 		using ValueType = std::remove_pointer_t<typename std::iterator_traits<It>::value_type>;
 
 		ToContainer result;
 		raii_ptrs_container_wrapper<ToContainer> backout{ result };
 
-		result.reserve(std::distance(first, last));
+		// Single pass for forward iterators (lists of pointers): geometric growth instead of a counting walk.
+		if constexpr (detail::IsRandomAccessIter<It>())
+			result.reserve(static_cast<std::size_t>(last - first));
 		std::transform(first, last, std::back_inserter(result), [](auto pLeft) {
 			assert(pLeft != nullptr);
-			return new ValueType(*pLeft);
+			return RANGE_OF_PTRS_ADOPT(new ValueType(*pLeft), "DeepCopyOfRange");
 		});
 
 		backout.release();
@@ -361,6 +584,57 @@ namespace range_of_ptrs {
 	private:
 		BinaryFunctor func_;
 	};
+
+
+	// Writes `new T(*ptr)` for every selected pointee to `dest`, which may be std::back_inserter or
+	// uninitialized pointer storage: only the selected elements are allocated.
+	template<typename InIter, typename OutIter, typename Pred>
+	OutIter CopyIfToNew(InIter first, InIter last, OutIter dest, Pred pred)
+	{
+		RANGE_OF_PTRS_PERF_SCOPE("CopyIfToNew", detail::PerfRangeSize(first, last));
+		using ValueType = std::remove_cv_t<std::remove_pointer_t<typename std::iterator_traits<InIter>::value_type>>;
+
+		for (; first != last; ++first) {
+			assert(*first != nullptr);
+			if (pred(*(*first))) {
+				detail::WriteOwned(dest, RANGE_OF_PTRS_ADOPT(new ValueType(*(*first)), "CopyIfToNew"));
+				++dest;
+			}
+		}
+		return dest;
+	}
+
+	// Owning container with deep copies (CopyIfToContainer) or clones (CloneIfToContainer) of the
+	// selected pointees. Forward ranges are walked twice: the selected elements are counted first
+	// so the container is reserved exactly once, at its final size.
+	template<typename ToContainer, typename It, typename Pred>
+	ToContainer CopyIfToContainer(It first, It last, Pred pred)
+	{
+		ToContainer result;
+		raii_ptrs_container_wrapper<ToContainer> backout{ result };
+
+		if constexpr (std::is_base_of_v<std::forward_iterator_tag, typename std::iterator_traits<It>::iterator_category>)
+			result.reserve(static_cast<std::size_t>(std::count_if(first, last, UnaryFunctorDerefAdapter<Pred>(pred))));
+		CopyIfToNew(first, last, std::back_inserter(result), pred);
+
+		backout.release();
+		return result;
+	}
+
+	template<typename ToContainer, typename It, typename Pred>
+	ToContainer CloneIfToContainer(It first, It last, Pred pred)
+	{
+		ToContainer result;
+		raii_ptrs_container_wrapper<ToContainer> backout{ result };
+
+		if constexpr (std::is_base_of_v<std::forward_iterator_tag, typename std::iterator_traits<It>::iterator_category>)
+			result.reserve(static_cast<std::size_t>(std::count_if(first, last, UnaryFunctorDerefAdapter<Pred>(pred))));
+		CloneIf(first, last, std::back_inserter(result), pred);
+
+		backout.release();
+		return result;
+	}
+
 }
 
 
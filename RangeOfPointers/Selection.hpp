@@ -0,0 +1,197 @@
+#pragma once
+#ifndef RANGE_OF_POINTERS_SELECTION_HPP
+#define RANGE_OF_POINTERS_SELECTION_HPP
+
+// Late materialization: Select(first, last, pred) returns a selection (one bit per element of the
+// source pointer range) instead of copying the selected objects. Selections are combined with
+// & and |, narrowed with Refine, and only the final one is materialized (MaterializeCopy,
+// MaterializeClone, MaterializeDeepCopy), so a pipeline of filters makes no intermediate copies.
+//
+// A selection refers to the source range by position: the range must not be reordered or resized
+// between Select and Materialize.
+
+#include "RangeOfPointers.hpp"
+#include "Branchless.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+
+namespace range_of_ptrs {
+
+	class selection {
+	public:
+		static constexpr std::size_t wordBits = 64;
+
+		selection() = default;
+		explicit selection(std::size_t size) : size_{ size }, words_((size + wordBits - 1) / wordBits) {}
+
+		std::size_t size() const noexcept { return size_; }
+
+		std::size_t count() const noexcept
+		{
+			std::size_t result = 0;
+			for (std::uint64_t word : words_)
+				result += detail::PopCount64(word);
+			return result;
+		}
+
+		bool test(std::size_t index) const noexcept
+		{
+			assert(index < size_);
+			return (words_[index / wordBits] >> (index % wordBits)) & 1;
+		}
+
+		void set(std::size_t index) noexcept
+		{
+			assert(index < size_);
+			words_[index / wordBits] |= std::uint64_t{ 1 } << (index % wordBits);
+		}
+
+		// Bit i % 64 of word i / 64 is element i. Bits past size() stay zero.
+		std::uint64_t word(std::size_t index) const noexcept { return words_[index]; }
+		std::uint64_t& word(std::size_t index) noexcept { return words_[index]; }
+		std::size_t words_count() const noexcept { return words_.size(); }
+
+		selection& operator&=(const selection& other) noexcept
+		{
+			assert(size_ == other.size_);
+			for (std::size_t i = 0; i < words_.size(); ++i)
+				words_[i] &= other.words_[i];
+			return *this;
+		}
+
+		selection& operator|=(const selection& other) noexcept
+		{
+			assert(size_ == other.size_);
+			for (std::size_t i = 0; i < words_.size(); ++i)
+				words_[i] |= other.words_[i];
+			return *this;
+		}
+
+		friend selection operator&(selection lhs, const selection& rhs) { return lhs &= rhs; }
+		friend selection operator|(selection lhs, const selection& rhs) { return lhs |= rhs; }
+
+		// func(index) for every selected index, in increasing order.
+		template<typename Func>
+		void for_each(Func func) const
+		{
+			for (std::size_t w = 0; w < words_.size(); ++w) {
+				for (std::uint64_t mask = words_[w]; mask != 0; mask &= mask - 1)
+					func(w * wordBits + detail::CountTrailingZeros(mask));
+			}
+		}
+
+		// The selected positions as 32-bit indices.
+		std::vector<std::uint32_t> indices() const
+		{
+			assert(size_ <= std::numeric_limits<std::uint32_t>::max());
+			std::vector<std::uint32_t> result;
+			result.reserve(count());
+			for_each([&](std::size_t index) { result.push_back(static_cast<std::uint32_t>(index)); });
+			return result;
+		}
+
+	private:
+		std::size_t size_ = 0;
+		std::vector<std::uint64_t> words_;
+	};
+
+
+	// Bit i is set when pred(*first[i]); the predicate runs in blocks of 64 with no branch on its result.
+	template<typename InIter, typename Pred>
+	selection Select(InIter first, InIter last, Pred pred)
+	{
+		RANGE_OF_PTRS_PERF_SCOPE("Select", detail::PerfRangeSize(first, last));
+		if constexpr (detail::IsRandomAccessIter<InIter>()) {
+			selection result{ static_cast<std::size_t>(last - first) };
+			for (std::size_t w = 0, size = result.size(); size != 0; ++w) {
+				const std::size_t block = std::min(size, selection::wordBits);
+				result.word(w) = detail::SelectMask(first, block, pred);
+				first += block;
+				size -= block;
+			}
+			return result;
+		}
+		else {
+			selection result{ static_cast<std::size_t>(std::distance(first, last)) };
+			for (std::size_t i = 0; first != last; ++first, ++i) {
+				assert(*first != nullptr);
+				if (pred(*(*first)))
+					result.set(i);
+			}
+			return result;
+		}
+	}
+
+	// sel & Select(first, ...), evaluating pred only for the elements still selected.
+	template<typename RandomIt, typename Pred>
+	selection Refine(const selection& sel, RandomIt first, Pred pred)
+	{
+		RANGE_OF_PTRS_PERF_SCOPE("Refine", sel.size());
+		selection result{ sel.size() };
+		sel.for_each([&](std::size_t index) {
+			assert(first[index] != nullptr);
+			if (pred(*first[index]))
+				result.set(index);
+		});
+		return result;
+	}
+
+
+	// Copy-assigns the selected pointees, in order, to the live objects of dest.
+	template<typename RandomIt, typename OutIter>
+	OutIter MaterializeCopy(RandomIt first, const selection& sel, OutIter dest)
+	{
+		RANGE_OF_PTRS_PERF_SCOPE("MaterializeCopy", sel.size());
+		sel.for_each([&](std::size_t index) {
+			assert(*dest != nullptr);
+			assert(first[index] != nullptr);
+			*(*dest) = *first[index];
+			++dest;
+		});
+		return dest;
+	}
+
+	// Writes Clone() of the selected pointees to dest (std::back_inserter or uninitialized pointer storage).
+	template<typename RandomIt, typename OutIter>
+	OutIter MaterializeClone(RandomIt first, const selection& sel, OutIter dest)
+	{
+		RANGE_OF_PTRS_PERF_SCOPE("MaterializeClone", sel.size());
+		sel.for_each([&](std::size_t index) {
+			assert(first[index] != nullptr);
+			detail::WriteOwned(dest, RANGE_OF_PTRS_ADOPT(first[index]->Clone(), "MaterializeClone"));
+			++dest;
+		});
+		return dest;
+	}
+
+	// Returns an owning container with `new T` copies of the selected pointees.
+	template<typename ToContainer, typename RandomIt>
+	ToContainer MaterializeDeepCopy(RandomIt first, const selection& sel)
+	{
+		RANGE_OF_PTRS_PERF_SCOPE("MaterializeDeepCopy", sel.size());
+		using ValueType = std::remove_cv_t<std::remove_pointer_t<typename std::iterator_traits<RandomIt>::value_type>>;
+
+		ToContainer result;
+		raii_ptrs_container_wrapper<ToContainer> backout{ result };
+
+		result.reserve(sel.count());
+		auto dest = std::back_inserter(result);
+		sel.for_each([&](std::size_t index) {
+			assert(first[index] != nullptr);
+			detail::WriteOwned(dest, RANGE_OF_PTRS_ADOPT(new ValueType(*first[index]), "MaterializeDeepCopy"));
+		});
+
+		backout.release();
+		return result;
+	}
+}
+
+#endif // !RANGE_OF_POINTERS_SELECTION_HPP
@@ -0,0 +1,310 @@
+#pragma once
+#ifndef RANGE_OF_POINTERS_SERIALIZATION_HPP
+#define RANGE_OF_POINTERS_SERIALIZATION_HPP
+
+// Binary save and load of ranges of pointers to trivially copyable objects.
+//
+// Layout of a serialized range: a serialized_header, zero padding up to header.data_offset,
+// then header.count objects of header.element_size bytes back to back.
+// Headers are validated before anything is allocated, and Deserialize allocates as the objects
+// arrive rather than trusting header.count, so corrupt or hostile input is rejected with
+// std::runtime_error.
+//
+// A sink is any object with
+//     void write(const void* data, std::size_t size);   // data must stay valid until flush()
+//     void flush();
+// and a source any object with
+//     void read(void* data, std::size_t size);          // reads exactly size bytes or throws
+// fd_sink / fd_source (POSIX descriptors, writev batching) and ostream_sink / istream_source
+// are provided.
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <new>
+#include <ostream>
+#include <stdexcept>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <cerrno>
+#include <climits>
+#include <sys/uio.h>
+#include <unistd.h>
+#define RANGE_OF_PTRS_HAS_POSIX_IO 1
+#endif
+
+
+namespace range_of_ptrs {
+
+	struct serialized_header {
+		char magic[4] = { 'R', 'o', 'P', 'S' };
+		std::uint32_t version = 1;
+		std::uint32_t element_size = 0;
+		std::uint32_t element_align = 0;
+		std::uint64_t count = 0;
+		std::uint64_t data_offset = 64;     // objects start here, aligned for mmap
+	};
+	static_assert(sizeof(serialized_header) == 32, "serialized_header layout changed");
+
+	// Largest data_offset accepted: where Serialize puts the objects, aligned for every supported T.
+	inline constexpr std::uint64_t serializedMaxDataOffset = 64;
+
+	template<typename T>
+	serialized_header MakeSerializedHeader(std::uint64_t count)
+	{
+		static_assert(alignof(T) <= serializedMaxDataOffset, "over-aligned types are not supported");
+
+		serialized_header header;
+		header.element_size = static_cast<std::uint32_t>(sizeof(T));
+		header.element_align = static_cast<std::uint32_t>(alignof(T));
+		header.count = count;
+		return header;
+	}
+
+	template<typename T>
+	void ValidateSerializedHeader(const serialized_header& header)
+	{
+		const serialized_header expected = MakeSerializedHeader<T>(header.count);
+		if (std::memcmp(header.magic, expected.magic, sizeof(header.magic)) != 0 || header.version != expected.version)
+			throw std::runtime_error("range_of_ptrs: not a serialized pointer range");
+		if (header.element_size != expected.element_size || header.element_align != expected.element_align)
+			throw std::runtime_error("range_of_ptrs: serialized element type does not match");
+		if (header.data_offset < sizeof(serialized_header) || header.data_offset > serializedMaxDataOffset
+			|| header.data_offset % header.element_align != 0)
+			throw std::runtime_error("range_of_ptrs: corrupt serialized header");
+		if (header.count > std::numeric_limits<std::size_t>::max() / sizeof(T))
+			throw std::runtime_error("range_of_ptrs: serialized range too large");
+	}
+
+
+	// Owns raw memory blocks for objects that are never destroyed individually.
+	// Pointers into an arena must not be deleted (do not hand them to raii_ptrs_*_wrapper).
+	class ptr_arena {
+	public:
+		ptr_arena() = default;
+		ptr_arena(const ptr_arena&) = delete;
+		ptr_arena& operator=(const ptr_arena&) = delete;
+		ptr_arena(ptr_arena&&) noexcept = default;
+		ptr_arena& operator=(ptr_arena&&) noexcept = default;
+
+		// Uninitialized storage for `count` objects of T.
+		template<typename T>
+		T* allocate(std::size_t count)
+		{
+			static_assert(std::is_trivially_destructible_v<T>, "arena objects are never destroyed");
+			if (count == 0) return nullptr;
+
+			void* block = ::operator new(count * sizeof(T), std::align_val_t{ alignof(T) });
+			blocks_.push_back(block_ptr{ block, block_deleter{ alignof(T) } });
+			return static_cast<T*>(block);
+		}
+
+		std::size_t blocks_count() const noexcept { return blocks_.size(); }
+
+	private:
+		struct block_deleter {
+			std::size_t align;
+			void operator()(void* block) const noexcept { ::operator delete(block, std::align_val_t{ align }); }
+		};
+		using block_ptr = std::unique_ptr<void, block_deleter>;
+
+		std::vector<block_ptr> blocks_;
+	};
+
+
+	struct ostream_sink {
+		explicit ostream_sink(std::ostream& os) : os_{ os } {}
+
+		void write(const void* data, std::size_t size)
+		{
+			if (!os_.write(static_cast<const char*>(data), static_cast<std::streamsize>(size)))
+				throw std::runtime_error("range_of_ptrs: stream write failed");
+		}
+		void flush() { os_.flush(); }
+
+	private:
+		std::ostream& os_;
+	};
+
+	struct istream_source {
+		explicit istream_source(std::istream& is) : is_{ is } {}
+
+		void read(void* data, std::size_t size)
+		{
+			if (!is_.read(static_cast<char*>(data), static_cast<std::streamsize>(size)))
+				throw std::runtime_error("range_of_ptrs: unexpected end of stream");
+		}
+
+	private:
+		std::istream& is_;
+	};
+
+
+#ifdef RANGE_OF_PTRS_HAS_POSIX_IO
+	// Gathers writes into iovecs and hands them to writev in batches of IOV_MAX.
+	// Nothing is written before flush() or a full batch. The descriptor is not owned.
+	struct fd_sink {
+		explicit fd_sink(int fd) : fd_{ fd } {}
+		fd_sink(const fd_sink&) = delete;
+		fd_sink& operator=(const fd_sink&) = delete;
+
+		void write(const void* data, std::size_t size)
+		{
+			if (size == 0) return;
+			iovs_.push_back(iovec{ const_cast<void*>(data), size });
+			if (iovs_.size() == batch_size())
+				flush();
+		}
+
+		void flush()
+		{
+			iovec* iov = iovs_.data();
+			std::size_t left = iovs_.size();
+			while (left != 0) {
+				const ssize_t written = ::writev(fd_, iov, static_cast<int>(std::min(left, batch_size())));
+				if (written < 0) {
+					if (errno == EINTR) continue;
+					iovs_.clear();
+					throw std::system_error(errno, std::generic_category(), "range_of_ptrs: writev");
+				}
+
+				auto done = static_cast<std::size_t>(written);
+				while (left != 0 && done >= iov->iov_len) {
+					done -= iov->iov_len;
+					++iov;
+					--left;
+				}
+				if (left != 0) {
+					iov->iov_base = static_cast<char*>(iov->iov_base) + done;
+					iov->iov_len -= done;
+				}
+			}
+			iovs_.clear();
+		}
+
+	private:
+		static std::size_t batch_size() noexcept
+		{
+#ifdef IOV_MAX
+			return IOV_MAX;
+#else
+			return 1024;
+#endif
+		}
+
+		int fd_;
+		std::vector<iovec> iovs_;
+	};
+
+	// Reads from a descriptor that is not owned.
+	struct fd_source {
+		explicit fd_source(int fd) : fd_{ fd } {}
+
+		void read(void* data, std::size_t size)
+		{
+			auto out = static_cast<char*>(data);
+			while (size != 0) {
+				const ssize_t got = ::read(fd_, out, size);
+				if (got < 0) {
+					if (errno == EINTR) continue;
+					throw std::system_error(errno, std::generic_category(), "range_of_ptrs: read");
+				}
+				if (got == 0)
+					throw std::runtime_error("range_of_ptrs: unexpected end of file");
+				out += got;
+				size -= static_cast<std::size_t>(got);
+			}
+		}
+
+	private:
+		int fd_;
+	};
+#endif
+
+
+	// Writes the pointees of [first, last) to `sink`. Pointees that are adjacent in memory
+	// are written with a single sink.write(), so packed ranges go out as one bulk write.
+	template<typename Iter, typename Sink>
+	void Serialize(Iter first, Iter last, Sink& sink)
+	{
+		using ValueType = std::remove_cv_t<std::remove_pointer_t<typename std::iterator_traits<Iter>::value_type>>;
+		static_assert(std::is_trivially_copyable_v<ValueType>, "Serialize requires trivially copyable pointees");
+
+		// The header and padding must outlive sink.flush().
+		const serialized_header header = MakeSerializedHeader<ValueType>(static_cast<std::uint64_t>(std::distance(first, last)));
+		static const char padding[64] = {};
+		sink.write(&header, sizeof(header));
+		sink.write(padding, header.data_offset - sizeof(header));
+
+		const ValueType* runBegin = nullptr;
+		const ValueType* runEnd = nullptr;
+		for (; first != last; ++first) {
+			const ValueType* ptr = *first;
+			assert(ptr != nullptr);
+			if (ptr != runEnd) {
+				if (runBegin != nullptr)
+					sink.write(runBegin, static_cast<std::size_t>(runEnd - runBegin) * sizeof(ValueType));
+				runBegin = ptr;
+			}
+			runEnd = ptr + 1;
+		}
+		if (runBegin != nullptr)
+			sink.write(runBegin, static_cast<std::size_t>(runEnd - runBegin) * sizeof(ValueType));
+
+		sink.flush();
+	}
+
+	template<typename Container, typename Sink>
+	void Serialize(const Container& container, Sink& sink)
+	{
+		Serialize(std::cbegin(container), std::cend(container), sink);
+	}
+
+	// Objects of the first block Deserialize allocates; every further block is twice the previous one.
+	inline constexpr std::size_t deserializeFirstBlockBytes = std::size_t{ 64 } << 10;
+
+	// Reads a range written by Serialize into blocks of `arena` and returns pointers to the objects.
+	// The objects are owned by the arena. The blocks double in size, so a header.count larger than
+	// the source holds costs at most twice the bytes actually read before the read fails.
+	template<typename Container, typename Source>
+	Container Deserialize(Source& source, ptr_arena& arena)
+	{
+		using ValueType = std::remove_pointer_t<typename Container::value_type>;
+		static_assert(std::is_trivially_copyable_v<ValueType>, "Deserialize requires trivially copyable pointees");
+
+		serialized_header header;
+		source.read(&header, sizeof(header));
+		ValidateSerializedHeader<ValueType>(header);
+
+		char padding[serializedMaxDataOffset];
+		source.read(padding, static_cast<std::size_t>(header.data_offset - sizeof(header)));
+
+		auto remaining = static_cast<std::size_t>(header.count);
+		std::size_t blockSize = std::max<std::size_t>(deserializeFirstBlockBytes / sizeof(ValueType), 1);
+
+		Container result;
+		result.reserve(std::min(remaining, blockSize));
+		while (remaining != 0) {
+			const std::size_t count = std::min(remaining, blockSize);
+			ValueType* block = arena.allocate<ValueType>(count);
+			source.read(block, count * sizeof(ValueType));
+			for (std::size_t i = 0; i < count; ++i)
+				result.push_back(block + i);
+			remaining -= count;
+			if (blockSize <= remaining / 2)
+				blockSize *= 2;
+		}
+		return result;
+	}
+}
+
+#endif // !RANGE_OF_POINTERS_SERIALIZATION_HPP
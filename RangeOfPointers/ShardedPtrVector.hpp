@@ -0,0 +1,278 @@
+#pragma once
+#ifndef RANGE_OF_POINTERS_SHARDED_PTR_VECTOR_HPP
+#define RANGE_OF_POINTERS_SHARDED_PTR_VECTOR_HPP
+
+#include "RangeOfPointers.hpp"
+#include "Parallel.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+
+namespace range_of_ptrs {
+
+	// Owning vector of pointers split into shards that the algorithms process in parallel,
+	// one thread per shard and call. Pointees are plain `new T` objects, as everywhere else in the
+	// library, so the per-shard algorithms can delete them.
+	//
+	// The global order of the elements is shard-major: all of shard 0, then all of shard 1, ...
+	// begin()/end() walk that order for algorithms that depend on it.
+	//
+	// A moved-from container has no shards: it is empty and may only be destroyed, assigned to,
+	// cleared or iterated.
+	template<typename T>
+	class sharded_ptr_vector {
+	public:
+		using value_type = T*;
+		using size_type = std::size_t;
+		using shard_type = std::vector<T*>;
+
+		// Forward iterator over all shards in shard-major order.
+		template<typename Owner, typename Ref>
+		struct basic_iterator {
+			using iterator_category = std::forward_iterator_tag;
+			using value_type = T*;
+			using difference_type = std::ptrdiff_t;
+			using pointer = std::remove_reference_t<Ref>*;
+			using reference = Ref;
+
+			basic_iterator() = default;
+			basic_iterator(Owner* owner, size_type shard, size_type offset) : owner_{ owner }, shard_{ shard }, offset_{ offset } { skip_empty(); }
+
+			reference operator*() const { return owner_->shards_[shard_][offset_]; }
+
+			basic_iterator& operator++() { ++offset_; skip_empty(); return *this; }
+			basic_iterator operator++(int) { auto tmp = *this; ++(*this); return tmp; }
+
+			friend bool operator==(const basic_iterator& lhs, const basic_iterator& rhs) { return lhs.shard_ == rhs.shard_ && lhs.offset_ == rhs.offset_; }
+			friend bool operator!=(const basic_iterator& lhs, const basic_iterator& rhs) { return !(lhs == rhs); }
+
+		private:
+			void skip_empty()
+			{
+				while (shard_ < owner_->shards_.size() && offset_ == owner_->shards_[shard_].size()) {
+					++shard_;
+					offset_ = 0;
+				}
+			}
+
+			Owner* owner_ = nullptr;
+			size_type shard_ = 0;
+			size_type offset_ = 0;
+		};
+
+		using iterator = basic_iterator<sharded_ptr_vector, T*&>;
+		using const_iterator = basic_iterator<const sharded_ptr_vector, T* const&>;
+
+		explicit sharded_ptr_vector(size_type shards = std::max(1u, std::thread::hardware_concurrency()))
+			: shards_(std::max<size_type>(shards, 1)) {}
+
+		sharded_ptr_vector(const sharded_ptr_vector&) = delete;
+		sharded_ptr_vector& operator=(const sharded_ptr_vector&) = delete;
+
+		sharded_ptr_vector(sharded_ptr_vector&& other) noexcept : shards_(std::move(other.shards_)), next_{ other.next_ }
+		{
+			other.shards_.clear();
+			other.next_ = 0;
+		}
+		sharded_ptr_vector& operator=(sharded_ptr_vector&& other) noexcept
+		{
+			if (this == &other) return *this;
+			clear();
+			shards_ = std::move(other.shards_);
+			next_ = other.next_;
+			other.shards_.clear();
+			other.next_ = 0;
+			return *this;
+		}
+
+		~sharded_ptr_vector() { clear(); }
+
+		// Takes ownership of `ptr`; shards are filled round-robin.
+		void push_back(T* ptr)
+		{
+			assert(!shards_.empty());
+			push_back(next_, ptr);
+			next_ = (next_ + 1) % shards_.size();
+		}
+
+		void push_back(size_type shard, T* ptr)
+		{
+			assert(shard < shards_.size());
+			raii_ptrs_range_wrapper<T**> backout{ &ptr, &ptr + 1 };
+			shards_[shard].push_back(ptr);
+			backout.release();
+		}
+
+		size_type shards_count() const noexcept { return shards_.size(); }
+		shard_type& shard(size_type index) { return shards_[index]; }
+		const shard_type& shard(size_type index) const { return shards_[index]; }
+
+		size_type size() const noexcept
+		{
+			size_type result = 0;
+			for (const auto& s : shards_)
+				result += s.size();
+			return result;
+		}
+		bool empty() const noexcept { return size() == 0; }
+
+		iterator begin() { return iterator{ this, 0, 0 }; }
+		iterator end() { return iterator{ this, shards_.size(), 0 }; }
+		const_iterator begin() const { return const_iterator{ this, 0, 0 }; }
+		const_iterator end() const { return const_iterator{ this, shards_.size(), 0 }; }
+
+		// Deletes the pointees on the calling thread; also runs from the destructor and move assignment,
+		// which must not start threads.
+		void clear() noexcept
+		{
+			for (auto& s : shards_) {
+				for (auto ptr : s)
+					RANGE_OF_PTRS_DELETE(ptr, "sharded_ptr_vector::clear");
+				s.clear();
+			}
+		}
+
+		// Runs func(shard, index) for every shard, each on its own thread (the calling thread takes shard 0).
+		// The first exception thrown by any shard is rethrown after all shards finished; if a thread cannot
+		// be started, the shards already running are joined before that error propagates.
+		template<typename Func>
+		void for_each_shard(Func func)
+		{
+			detail::ParallelParts(shards_.size(), [&](size_type index) { func(shards_[index], index); });
+		}
+
+
+		template<typename Value>
+		void Remove(const Value& value)
+		{
+			for_each_shard([&](shard_type& s, size_type) {
+				s.erase(range_of_ptrs::Remove(std::begin(s), std::end(s), value), std::end(s));
+			});
+		}
+
+		template<typename Predicate>
+		void RemoveIf(Predicate pred)
+		{
+			for_each_shard([&](shard_type& s, size_type) {
+				s.erase(range_of_ptrs::RemoveIf(std::begin(s), std::end(s), 0, pred), std::end(s));
+			});
+		}
+
+		// Removes consecutive equal elements in the global order: every shard in parallel,
+		// then the runs that continue across shard boundaries.
+		template<typename BinaryPredicate = std::equal_to<>>
+		void Unique(BinaryPredicate pred = BinaryPredicate())
+		{
+			for_each_shard([&](shard_type& s, size_type) {
+				s.erase(range_of_ptrs::Unique(std::begin(s), std::end(s), pred), std::end(s));
+			});
+
+			const T* last = nullptr;
+			for (auto& s : shards_) {
+				auto first = std::begin(s);
+				if (last != nullptr) {
+					for (; first != std::end(s) && pred(*last, *(*first)); ++first) {
+						RANGE_OF_PTRS_DELETE(*first, "sharded_ptr_vector::Unique");
+						*first = nullptr;
+					}
+					s.erase(std::begin(s), first);
+				}
+				if (!s.empty())
+					last = s.back();
+			}
+		}
+
+		// Sorts every shard in parallel. Use merged() for the globally sorted sequence.
+		template<typename Compare = std::less<>>
+		void SortShards(Compare comp = Compare())
+		{
+			for_each_shard([&](shard_type& s, size_type) {
+				std::sort(std::begin(s), std::end(s), BinaryFunctorDerefPtrsAdapter<Compare>(comp));
+			});
+		}
+
+		// Non-owning k-way merge of shards that are each sorted by `comp`.
+		template<typename Compare = std::less<>>
+		std::vector<T*> merged(Compare comp = Compare()) const
+		{
+			using Cursor = std::pair<typename shard_type::const_iterator, typename shard_type::const_iterator>;
+			auto greater = [&](const Cursor& lhs, const Cursor& rhs) { return comp(*(*rhs.first), *(*lhs.first)); };
+			std::priority_queue<Cursor, std::vector<Cursor>, decltype(greater)> heads(greater);
+			for (const auto& s : shards_) {
+				if (!s.empty()) heads.push({ std::begin(s), std::end(s) });
+			}
+
+			std::vector<T*> result;
+			result.reserve(size());
+			while (!heads.empty()) {
+				Cursor head = heads.top();
+				heads.pop();
+				result.push_back(*head.first);
+				if (++head.first != head.second)
+					heads.push(head);
+			}
+			return result;
+		}
+
+		// New container with deep copies of the elements that satisfy `pred`, shard for shard.
+		template<typename Predicate>
+		sharded_ptr_vector CopyIf(Predicate pred) const
+		{
+			return transform_shards([&](const shard_type& from, shard_type& to) {
+				for (auto ptr : from) {
+					assert(ptr != nullptr);
+					if (pred(*ptr))
+						to.push_back(RANGE_OF_PTRS_ADOPT(new T(*ptr), "sharded_ptr_vector::CopyIf"));
+				}
+			});
+		}
+
+		// New container with ptr->Clone() of every element, shard for shard.
+		sharded_ptr_vector Clone() const
+		{
+			return transform_shards([](const shard_type& from, shard_type& to) {
+				to.resize(from.size(), nullptr);
+				for (size_type i = 0; i < from.size(); ++i) {
+					assert(from[i] != nullptr);
+					to[i] = RANGE_OF_PTRS_ADOPT(from[i]->Clone(), "sharded_ptr_vector::Clone");
+				}
+			});
+		}
+
+		// New container with `new T(*ptr)` of every element, shard for shard.
+		sharded_ptr_vector DeepCopy() const
+		{
+			return transform_shards([](const shard_type& from, shard_type& to) {
+				to = DeepCopyOfRange<shard_type>(std::begin(from), std::end(from));
+			});
+		}
+
+	private:
+		// Builds a container with the same shard count where shard i is produced from shard i of *this.
+		template<typename Func>
+		sharded_ptr_vector transform_shards(Func func) const
+		{
+			sharded_ptr_vector result(shards_.size());
+			result.shards_.resize(shards_.size());     // none when *this was moved from
+			result.next_ = next_;
+			result.for_each_shard([&](shard_type& to, size_type index) {
+				func(shards_[index], to);
+			});
+			return result;
+		}
+
+		std::vector<shard_type> shards_;
+		size_type next_ = 0;
+	};
+}
+
+#endif // !RANGE_OF_POINTERS_SHARDED_PTR_VECTOR_HPP
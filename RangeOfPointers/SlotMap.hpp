@@ -0,0 +1,227 @@
+#pragma once
+#ifndef RANGE_OF_POINTERS_SLOT_MAP_HPP
+#define RANGE_OF_POINTERS_SLOT_MAP_HPP
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <utility>
+#include <vector>
+
+
+namespace range_of_ptrs {
+
+	// Random access iterator over a contiguous array of T that yields the element addresses,
+	// so that the pointer range algorithms can work on packed storage.
+	template<typename T>
+	struct address_iterator {
+		using iterator_category = std::random_access_iterator_tag;
+		using value_type = T*;
+		using difference_type = std::ptrdiff_t;
+		using pointer = T* const*;
+		using reference = T*;
+
+		address_iterator() = default;
+		explicit address_iterator(T* ptr) : ptr_{ ptr } {}
+
+		reference operator*() const noexcept { return ptr_; }
+		reference operator[](difference_type n) const noexcept { return ptr_ + n; }
+
+		address_iterator& operator++() noexcept { ++ptr_; return *this; }
+		address_iterator operator++(int) noexcept { auto tmp = *this; ++ptr_; return tmp; }
+		address_iterator& operator--() noexcept { --ptr_; return *this; }
+		address_iterator operator--(int) noexcept { auto tmp = *this; --ptr_; return tmp; }
+
+		address_iterator& operator+=(difference_type n) noexcept { ptr_ += n; return *this; }
+		address_iterator& operator-=(difference_type n) noexcept { ptr_ -= n; return *this; }
+		friend address_iterator operator+(address_iterator it, difference_type n) noexcept { return it += n; }
+		friend address_iterator operator+(difference_type n, address_iterator it) noexcept { return it += n; }
+		friend address_iterator operator-(address_iterator it, difference_type n) noexcept { return it -= n; }
+		friend difference_type operator-(address_iterator lhs, address_iterator rhs) noexcept { return lhs.ptr_ - rhs.ptr_; }
+
+		friend bool operator==(address_iterator lhs, address_iterator rhs) noexcept { return lhs.ptr_ == rhs.ptr_; }
+		friend bool operator!=(address_iterator lhs, address_iterator rhs) noexcept { return lhs.ptr_ != rhs.ptr_; }
+		friend bool operator< (address_iterator lhs, address_iterator rhs) noexcept { return lhs.ptr_ < rhs.ptr_; }
+		friend bool operator> (address_iterator lhs, address_iterator rhs) noexcept { return lhs.ptr_ > rhs.ptr_; }
+		friend bool operator<=(address_iterator lhs, address_iterator rhs) noexcept { return lhs.ptr_ <= rhs.ptr_; }
+		friend bool operator>=(address_iterator lhs, address_iterator rhs) noexcept { return lhs.ptr_ >= rhs.ptr_; }
+
+	private:
+		T* ptr_ = nullptr;
+	};
+
+
+	// Dense storage of values addressed by generational handles.
+	// Values live in one packed array: insert appends, erase moves the last value into the hole,
+	// both in O(1). A handle stays valid until its value is erased; afterwards the slot generation
+	// no longer matches, so stale handles are detected instead of dangling.
+	// Addresses of values are stable only until the next insert or erase.
+	template<typename T>
+	class slot_map {
+	public:
+		struct handle {
+			std::uint32_t index = std::numeric_limits<std::uint32_t>::max();
+			std::uint32_t generation = 0;
+
+			friend bool operator==(handle lhs, handle rhs) noexcept { return lhs.index == rhs.index && lhs.generation == rhs.generation; }
+			friend bool operator!=(handle lhs, handle rhs) noexcept { return !(lhs == rhs); }
+		};
+
+		using value_type = T;
+		using size_type = std::size_t;
+		using iterator = typename std::vector<T>::iterator;
+		using const_iterator = typename std::vector<T>::const_iterator;
+		using ptrs_iterator = address_iterator<T>;
+		using const_ptrs_iterator = address_iterator<const T>;
+
+		slot_map() = default;
+
+		// If constructing the value throws, the map is left unchanged: the bookkeeping vectors get
+		// their room first, and the slot is claimed only once the value exists.
+		template<typename... Args>
+		handle emplace(Args&&... args)
+		{
+			assert(values_.size() < std::numeric_limits<std::uint32_t>::max());
+
+			grow_for_one(denseToSlot_);
+			if (freeHead_ == npos)
+				grow_for_one(slots_);
+			// values_ grows by itself: args may refer to one of its values.
+			values_.emplace_back(std::forward<Args>(args)...);
+
+			std::uint32_t index;
+			if (freeHead_ != npos) {
+				index = freeHead_;
+				freeHead_ = slots_[index].target;
+			}
+			else {
+				index = static_cast<std::uint32_t>(slots_.size());
+				slots_.push_back(slot{});
+			}
+
+			denseToSlot_.push_back(index);
+			slots_[index].target = static_cast<std::uint32_t>(values_.size() - 1);
+			return handle{ index, slots_[index].generation };
+		}
+
+		handle insert(const T& value) { return emplace(value); }
+		handle insert(T&& value) { return emplace(std::move(value)); }
+
+		bool erase(handle h)
+		{
+			if (!contains(h)) return false;
+
+			const std::uint32_t dense = slots_[h.index].target;
+			const std::uint32_t last = static_cast<std::uint32_t>(values_.size() - 1);
+			if (dense != last) {
+				values_[dense] = std::move(values_[last]);
+				denseToSlot_[dense] = denseToSlot_[last];
+				slots_[denseToSlot_[dense]].target = dense;
+			}
+			values_.pop_back();
+			denseToSlot_.pop_back();
+
+			++slots_[h.index].generation;
+			slots_[h.index].target = freeHead_;
+			freeHead_ = h.index;
+			return true;
+		}
+
+		bool contains(handle h) const noexcept
+		{
+			return h.index < slots_.size() && slots_[h.index].generation == h.generation && !is_free(h.index);
+		}
+
+		T* get(handle h) noexcept { return contains(h) ? &values_[slots_[h.index].target] : nullptr; }
+		const T* get(handle h) const noexcept { return contains(h) ? &values_[slots_[h.index].target] : nullptr; }
+
+		T& operator[](handle h) { assert(contains(h)); return values_[slots_[h.index].target]; }
+		const T& operator[](handle h) const { assert(contains(h)); return values_[slots_[h.index].target]; }
+
+		// Handle of the value at position `dense` of the packed array.
+		handle handle_at(size_type dense) const
+		{
+			assert(dense < values_.size());
+			const std::uint32_t index = denseToSlot_[dense];
+			return handle{ index, slots_[index].generation };
+		}
+
+		size_type size() const noexcept { return values_.size(); }
+		bool empty() const noexcept { return values_.empty(); }
+
+		void reserve(size_type count)
+		{
+			values_.reserve(count);
+			denseToSlot_.reserve(count);
+			slots_.reserve(count);
+		}
+
+		void clear()
+		{
+			for (std::uint32_t index : denseToSlot_) {
+				++slots_[index].generation;
+				slots_[index].target = freeHead_;
+				freeHead_ = index;
+			}
+			values_.clear();
+			denseToSlot_.clear();
+		}
+
+		// Packed values, in no particular order.
+		iterator begin() noexcept { return values_.begin(); }
+		iterator end() noexcept { return values_.end(); }
+		const_iterator begin() const noexcept { return values_.begin(); }
+		const_iterator end() const noexcept { return values_.end(); }
+
+		// The same values seen as a range of pointers, for Copy, Clone, DeepCopyOfRange and friends.
+		ptrs_iterator ptrs_begin() noexcept { return ptrs_iterator{ values_.data() }; }
+		ptrs_iterator ptrs_end() noexcept { return ptrs_iterator{ values_.data() + values_.size() }; }
+		const_ptrs_iterator ptrs_begin() const noexcept { return const_ptrs_iterator{ values_.data() }; }
+		const_ptrs_iterator ptrs_end() const noexcept { return const_ptrs_iterator{ values_.data() + values_.size() }; }
+
+	private:
+		static constexpr std::uint32_t npos = std::numeric_limits<std::uint32_t>::max();
+
+		// For a used slot `target` is the position in values_, for a free one the next free slot.
+		struct slot {
+			std::uint32_t target = npos;
+			std::uint32_t generation = 0;
+		};
+
+		// Room for one more element, with the usual geometric growth, so the next push_back cannot throw.
+		template<typename Vector>
+		static void grow_for_one(Vector& v)
+		{
+			if (v.size() == v.capacity())
+				v.reserve(v.empty() ? 8 : v.size() * 2);
+		}
+
+		bool is_free(std::uint32_t index) const noexcept
+		{
+			const std::uint32_t dense = slots_[index].target;
+			return dense >= denseToSlot_.size() || denseToSlot_[dense] != index;
+		}
+
+		std::vector<T> values_;
+		std::vector<std::uint32_t> denseToSlot_;
+		std::vector<slot> slots_;
+		std::uint32_t freeHead_ = npos;
+	};
+
+
+	// Copies the values of a pointer range into the slot map, one handle per element.
+	template<typename InIter, typename T>
+	std::vector<typename slot_map<T>::handle> InsertFromPtrs(InIter first, InIter last, slot_map<T>& dest)
+	{
+		std::vector<typename slot_map<T>::handle> handles;
+		for (; first != last; ++first) {
+			assert(*first != nullptr);
+			handles.push_back(dest.insert(*(*first)));
+		}
+		return handles;
+	}
+}
+
+#endif // !RANGE_OF_POINTERS_SLOT_MAP_HPP
@@ -0,0 +1,179 @@
+#pragma once
+#ifndef RANGE_OF_POINTERS_STREAMING_COPY_HPP
+#define RANGE_OF_POINTERS_STREAMING_COPY_HPP
+
+// File-to-file DeepCopy / CopyIf / Unique for serialized ranges (Serialization.hpp) that do not
+// fit in memory. Objects are processed chunk by chunk with two input and two output buffers:
+// while chunk i is filtered, chunk i+1 is read and chunk i-1 is written by background tasks,
+// so memory stays at 4 chunks whatever the file size. POSIX only.
+
+#include "Serialization.hpp"
+
+#ifdef RANGE_OF_PTRS_HAS_POSIX_IO
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <optional>
+#include <stdexcept>
+#include <system_error>
+#include <type_traits>
+
+
+namespace range_of_ptrs {
+
+	struct stream_options {
+		std::size_t chunk_bytes = std::size_t{ 8 } << 20;     // size of each of the 4 buffers
+	};
+
+	struct stream_result {
+		std::uint64_t read = 0;         // objects read from the input
+		std::uint64_t written = 0;      // objects written to the output
+	};
+
+	namespace detail {
+		inline void PreadAll(int fd, void* data, std::size_t size, std::uint64_t offset)
+		{
+			auto out = static_cast<char*>(data);
+			while (size != 0) {
+				const ssize_t got = ::pread(fd, out, size, static_cast<off_t>(offset));
+				if (got < 0) {
+					if (errno == EINTR) continue;
+					throw std::system_error(errno, std::generic_category(), "range_of_ptrs: pread");
+				}
+				if (got == 0)
+					throw std::runtime_error("range_of_ptrs: unexpected end of file");
+				out += got;
+				size -= static_cast<std::size_t>(got);
+				offset += static_cast<std::uint64_t>(got);
+			}
+		}
+
+		inline void PwriteAll(int fd, const void* data, std::size_t size, std::uint64_t offset)
+		{
+			auto in = static_cast<const char*>(data);
+			while (size != 0) {
+				const ssize_t written = ::pwrite(fd, in, size, static_cast<off_t>(offset));
+				if (written < 0) {
+					if (errno == EINTR) continue;
+					throw std::system_error(errno, std::generic_category(), "range_of_ptrs: pwrite");
+				}
+				in += written;
+				size -= static_cast<std::size_t>(written);
+				offset += static_cast<std::uint64_t>(written);
+			}
+		}
+	}
+
+
+	// Streams the objects of the serialized range in `inFd` to `outFd`, keeping those for which
+	// keep(const T&) returns true, in order. `outFd` receives a complete serialized range and is
+	// truncated to it. keep runs on the calling thread and may carry state across chunks.
+	// The descriptors are not owned.
+	template<typename T, typename Keep>
+	stream_result StreamFilter(int inFd, int outFd, Keep keep, const stream_options& options = stream_options())
+	{
+		static_assert(std::is_trivially_copyable_v<T>, "streaming requires trivially copyable objects");
+
+		serialized_header header;
+		detail::PreadAll(inFd, &header, sizeof(header), 0);
+		ValidateSerializedHeader<T>(header);
+
+		const std::size_t chunk = std::max<std::size_t>(options.chunk_bytes / sizeof(T), 1);
+		const serialized_header outHeader = MakeSerializedHeader<T>(0);
+
+		// The buffers must outlive the pending tasks, which are joined when the futures below are destroyed.
+		ptr_arena buffers;
+		T* in[2] = { buffers.allocate<T>(chunk), buffers.allocate<T>(chunk) };
+		T* out[2] = { buffers.allocate<T>(chunk), buffers.allocate<T>(chunk) };
+
+		stream_result result;
+		std::uint64_t inOffset = header.data_offset;
+		std::uint64_t outOffset = outHeader.data_offset;
+
+		std::future<std::size_t> pendingRead;
+		std::future<void> pendingWrite;
+
+		auto readChunk = [&](int buffer) {
+			const auto count = static_cast<std::size_t>(std::min<std::uint64_t>(header.count - result.read, chunk));
+			const std::uint64_t offset = inOffset;
+			result.read += count;
+			inOffset += count * sizeof(T);
+			T* data = in[buffer];
+			pendingRead = std::async(std::launch::async, [=] {
+				detail::PreadAll(inFd, data, count * sizeof(T), offset);
+				return count;
+			});
+		};
+
+		int current = 0;
+		if (result.read < header.count)
+			readChunk(current);
+
+		while (pendingRead.valid()) {
+			const std::size_t count = pendingRead.get();
+			if (result.read < header.count)
+				readChunk(current ^ 1);
+
+			// out[current] was last handed to a write that finished before the previous iteration ended.
+			const T* from = in[current];
+			T* to = out[current];
+			std::size_t kept = 0;
+			for (std::size_t i = 0; i < count; ++i) {
+				if (keep(from[i]))
+					to[kept++] = from[i];
+			}
+
+			if (pendingWrite.valid())
+				pendingWrite.get();
+			if (kept != 0) {
+				const std::uint64_t offset = outOffset;
+				pendingWrite = std::async(std::launch::async, [=] { detail::PwriteAll(outFd, to, kept * sizeof(T), offset); });
+				outOffset += kept * sizeof(T);
+				result.written += kept;
+			}
+			current ^= 1;
+		}
+		if (pendingWrite.valid())
+			pendingWrite.get();
+
+		const serialized_header finalHeader = MakeSerializedHeader<T>(result.written);
+		static const char padding[64] = {};
+		detail::PwriteAll(outFd, &finalHeader, sizeof(finalHeader), 0);
+		detail::PwriteAll(outFd, padding, finalHeader.data_offset - sizeof(finalHeader), sizeof(finalHeader));
+		if (::ftruncate(outFd, static_cast<off_t>(outOffset)) != 0)
+			throw std::system_error(errno, std::generic_category(), "range_of_ptrs: ftruncate");
+		return result;
+	}
+
+	template<typename T>
+	stream_result StreamDeepCopy(int inFd, int outFd, const stream_options& options = stream_options())
+	{
+		return StreamFilter<T>(inFd, outFd, [](const T&) { return true; }, options);
+	}
+
+	template<typename T, typename Predicate>
+	stream_result StreamCopyIf(int inFd, int outFd, Predicate pred, const stream_options& options = stream_options())
+	{
+		return StreamFilter<T>(inFd, outFd, pred, options);
+	}
+
+	// Drops objects equal to the previously kept one, across chunk boundaries too.
+	template<typename T, typename BinaryPredicate = std::equal_to<>>
+	stream_result StreamUnique(int inFd, int outFd, BinaryPredicate pred = BinaryPredicate(), const stream_options& options = stream_options())
+	{
+		std::optional<T> last;
+		return StreamFilter<T>(inFd, outFd, [&](const T& value) {
+			if (last && pred(*last, value)) return false;
+			last = value;
+			return true;
+		}, options);
+	}
+}
+
+#endif // RANGE_OF_PTRS_HAS_POSIX_IO
+
+#endif // !RANGE_OF_POINTERS_STREAMING_COPY_HPP
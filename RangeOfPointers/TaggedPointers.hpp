@@ -0,0 +1,220 @@
+#pragma once
+#ifndef RANGE_OF_POINTERS_TAGGED_POINTERS_HPP
+#define RANGE_OF_POINTERS_TAGGED_POINTERS_HPP
+
+// Pointer slots that carry a 16-bit key tag in the unused top bits of the address (x86-64 and
+// AArch64 user space addresses fit in 48 bits; 5-level paging is not supported).
+//
+// The tag must agree with the comparisons used with it, as the abbreviated keys do:
+// pred(a, b) implies tag(a) == tag(b) for UniqueTagged and RemoveTagged (FingerprintTag of a hash
+// will do), and comp(a, b) implies tag(a) <= tag(b) for SortTagged and the searches (PrefixTag of
+// an abbreviated key). Elements whose tags differ are then told apart without touching the pointees.
+//
+// untagged_iterator masks the tags off for the algorithms that only read the pointers
+// (Copy, CopyIf, DeepCopyOfRange, ...) and for raii_ptrs_range_wrapper, which can own a tagged range.
+
+#include "RangeOfPointers.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <type_traits>
+#include <vector>
+
+
+namespace range_of_ptrs {
+
+	template<typename T>
+	class tagged_ptr {
+		static_assert(sizeof(std::uintptr_t) == 8, "tagged pointers need 64-bit addresses");
+	public:
+		static constexpr unsigned tagShift = 48;
+		static constexpr std::uintptr_t addressMask = (std::uintptr_t{ 1 } << tagShift) - 1;
+
+		tagged_ptr() = default;
+		tagged_ptr(T* ptr, std::uint16_t tag) noexcept
+			: bits_{ reinterpret_cast<std::uintptr_t>(ptr) | (std::uintptr_t{ tag } << tagShift) }
+		{
+			assert((reinterpret_cast<std::uintptr_t>(ptr) & ~addressMask) == 0);
+		}
+
+		T* get() const noexcept { return reinterpret_cast<T*>(bits_ & addressMask); }
+		std::uint16_t tag() const noexcept { return static_cast<std::uint16_t>(bits_ >> tagShift); }
+
+		T& operator*() const noexcept { return *get(); }
+		T* operator->() const noexcept { return get(); }
+		explicit operator bool() const noexcept { return (bits_ & addressMask) != 0; }
+
+	private:
+		std::uintptr_t bits_ = 0;
+	};
+
+	// Folds a hash to 16 bits, for the equality based algorithms.
+	constexpr std::uint16_t FingerprintTag(std::uint64_t hash) noexcept
+	{
+		return static_cast<std::uint16_t>(hash ^ (hash >> 16) ^ (hash >> 32) ^ (hash >> 48));
+	}
+
+	// The top 16 bits of an order preserving key (AbbreviateString, AbbreviateInteger of wide values).
+	constexpr std::uint16_t PrefixTag(std::uint64_t key) noexcept
+	{
+		return static_cast<std::uint16_t>(key >> 48);
+	}
+
+
+	// Read-only view of a range of tagged_ptr as plain pointers. operator* returns the pointer by
+	// value, which is all the algorithms that do not write to the range need.
+	template<typename Iter>
+	class untagged_iterator {
+		using tagged_type = typename std::iterator_traits<Iter>::value_type;
+	public:
+		using iterator_category = typename std::iterator_traits<Iter>::iterator_category;
+		using value_type = decltype(std::declval<const tagged_type&>().get());
+		using difference_type = typename std::iterator_traits<Iter>::difference_type;
+		using pointer = void;
+		using reference = value_type;
+
+		untagged_iterator() = default;
+		explicit untagged_iterator(Iter it) : it_{ it } {}
+
+		Iter base() const { return it_; }
+
+		reference operator*() const { return (*it_).get(); }
+		reference operator[](difference_type n) const { return it_[n].get(); }
+
+		untagged_iterator& operator++() { ++it_; return *this; }
+		untagged_iterator operator++(int) { return untagged_iterator{ it_++ }; }
+		untagged_iterator& operator--() { --it_; return *this; }
+		untagged_iterator operator--(int) { return untagged_iterator{ it_-- }; }
+
+		untagged_iterator& operator+=(difference_type n) { it_ += n; return *this; }
+		untagged_iterator& operator-=(difference_type n) { it_ -= n; return *this; }
+		friend untagged_iterator operator+(untagged_iterator it, difference_type n) { return it += n; }
+		friend untagged_iterator operator+(difference_type n, untagged_iterator it) { return it += n; }
+		friend untagged_iterator operator-(untagged_iterator it, difference_type n) { return it -= n; }
+		friend difference_type operator-(const untagged_iterator& lhs, const untagged_iterator& rhs) { return lhs.it_ - rhs.it_; }
+
+		friend bool operator==(const untagged_iterator& lhs, const untagged_iterator& rhs) { return lhs.it_ == rhs.it_; }
+		friend bool operator!=(const untagged_iterator& lhs, const untagged_iterator& rhs) { return lhs.it_ != rhs.it_; }
+		friend bool operator< (const untagged_iterator& lhs, const untagged_iterator& rhs) { return lhs.it_ < rhs.it_; }
+		friend bool operator> (const untagged_iterator& lhs, const untagged_iterator& rhs) { return lhs.it_ > rhs.it_; }
+		friend bool operator<=(const untagged_iterator& lhs, const untagged_iterator& rhs) { return lhs.it_ <= rhs.it_; }
+		friend bool operator>=(const untagged_iterator& lhs, const untagged_iterator& rhs) { return lhs.it_ >= rhs.it_; }
+
+	private:
+		Iter it_;
+	};
+
+	template<typename Iter>
+	untagged_iterator<Iter> MakeUntagged(Iter it) { return untagged_iterator<Iter>{ it }; }
+
+
+	// The pointers of [first, last) tagged with tagOf(pointee), in range order.
+	template<typename InIter, typename TagOf>
+	std::vector<tagged_ptr<std::remove_pointer_t<typename std::iterator_traits<InIter>::value_type>>>
+		TagRange(InIter first, InIter last, TagOf tagOf)
+	{
+		RANGE_OF_PTRS_PERF_SCOPE("TagRange", detail::PerfRangeSize(first, last));
+		using PointeeType = std::remove_pointer_t<typename std::iterator_traits<InIter>::value_type>;
+
+		std::vector<tagged_ptr<PointeeType>> result;
+		if constexpr (detail::IsRandomAccessIter<InIter>())
+			result.reserve(static_cast<std::size_t>(last - first));
+		for (; first != last; ++first) {
+			assert(*first != nullptr);
+			result.emplace_back(*first, static_cast<std::uint16_t>(tagOf(*(*first))));
+		}
+		return result;
+	}
+
+
+	// Unique and Remove on tagged pointers: the pointees of the removed elements are deleted and
+	// their slots cleared. Pointees are compared only when the tags match.
+	template<typename ForwardIt, typename BinaryPredicate = std::equal_to<>>
+	ForwardIt UniqueTagged(ForwardIt first, ForwardIt last, BinaryPredicate pred = BinaryPredicate())
+	{
+		RANGE_OF_PTRS_PERF_SCOPE("UniqueTagged", detail::PerfRangeSize(first, last));
+		if (first == last)
+			return last;
+
+		auto result = first;
+		while (++first != last) {
+			assert(*first);
+			if (result->tag() != first->tag() || !pred(*(*result), *(*first))) {
+				++result;
+				*result = *first;
+			}
+			else {
+				RANGE_OF_PTRS_DELETE(first->get(), "UniqueTagged");
+				*first = {};
+			}
+		}
+		++result;
+		return result;
+	}
+
+	template<typename ForwardIt, typename T>
+	ForwardIt RemoveTagged(ForwardIt first, ForwardIt last, const T& value, std::uint16_t valueTag)
+	{
+		RANGE_OF_PTRS_PERF_SCOPE("RemoveTagged", detail::PerfRangeSize(first, last));
+		ForwardIt result = first;
+		for (; first != last; ++first) {
+			assert(*first);
+			if (first->tag() != valueTag || !(*(*first) == value)) {
+				*result = *first;
+				++result;
+			}
+			else {
+				RANGE_OF_PTRS_DELETE(first->get(), "RemoveTagged");
+				*first = {};
+			}
+		}
+		return result;
+	}
+
+
+	// Sorts by (tag, comp on the pointees).
+	template<typename RandomIt, typename Compare = std::less<>>
+	void SortTagged(RandomIt first, RandomIt last, Compare comp = Compare())
+	{
+		RANGE_OF_PTRS_PERF_SCOPE("SortTagged", detail::PerfRangeSize(first, last));
+		std::sort(first, last, [comp](const auto& lhs, const auto& rhs) {
+			if (lhs.tag() != rhs.tag())
+				return lhs.tag() < rhs.tag();
+			return comp(*lhs, *rhs);
+		});
+	}
+
+	// Searches in tagged pointers sorted by SortTagged with the same comp.
+	template<typename ForwardIt, typename T, typename Compare = std::less<>>
+	ForwardIt LowerBoundTagged(ForwardIt first, ForwardIt last, const T& value, std::uint16_t valueTag, Compare comp = Compare())
+	{
+		return std::lower_bound(first, last, value, [valueTag, comp](const auto& element, const T& rhs) {
+			if (element.tag() != valueTag)
+				return element.tag() < valueTag;
+			return comp(*element, rhs);
+		});
+	}
+
+	template<typename ForwardIt, typename T, typename Compare = std::less<>>
+	ForwardIt UpperBoundTagged(ForwardIt first, ForwardIt last, const T& value, std::uint16_t valueTag, Compare comp = Compare())
+	{
+		return std::upper_bound(first, last, value, [valueTag, comp](const T& lhs, const auto& element) {
+			if (valueTag != element.tag())
+				return valueTag < element.tag();
+			return comp(lhs, *element);
+		});
+	}
+
+	template<typename ForwardIt, typename T, typename Compare = std::less<>>
+	bool BinarySearchTagged(ForwardIt first, ForwardIt last, const T& value, std::uint16_t valueTag, Compare comp = Compare())
+	{
+		first = LowerBoundTagged(first, last, value, valueTag, comp);
+		return first != last && first->tag() == valueTag && !comp(value, *(*first));
+	}
+}
+
+#endif // !RANGE_OF_POINTERS_TAGGED_POINTERS_HPP
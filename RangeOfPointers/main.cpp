@@ -45,5 +45,5 @@ int main()
 		print(pVec);
 	}
 
-	return 0;
+	return TestObject::livingObjectsCount() == 0 ? 0 : 1;
 }
\ No newline at end of file
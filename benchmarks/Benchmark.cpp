@@ -0,0 +1,371 @@
+#include "RangeOfPointers.hpp"
+#include "AbbreviatedKeys.hpp"
+#include "Aliasing.hpp"
+#include "ArgSort.hpp"
+#include "Branchless.hpp"
+#include "NullPointers.hpp"
+#include "Selection.hpp"
+#include "TaggedPointers.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifdef RANGE_OF_PTRS_PERF_COUNTERS
+#include <iostream>
+#endif
+
+
+namespace bench
+{
+	struct Object {
+		Object() = default;
+		explicit Object(int v) : val_{ v } {}
+		virtual ~Object() = default;
+
+		virtual Object* Clone() const { return new Object(*this); }
+
+		inline bool operator==(const Object& other) const noexcept { return val_ == other.val_; }
+		inline bool operator< (const Object& other) const noexcept { return val_ < other.val_; }
+
+		inline int getValue() const noexcept { return val_; }
+
+	private:
+		int val_ = 0;
+		char payload_[48] = {};
+	};
+
+	// String keyed objects: the key lives in the string's heap buffer, one more miss per comparison.
+	struct Named {
+		explicit Named(std::string name) : name_{ std::move(name) } {}
+
+		inline bool operator==(const Named& other) const noexcept { return name_ == other.name_; }
+		inline bool operator< (const Named& other) const noexcept { return name_ < other.name_; }
+
+		inline const std::string& getName() const noexcept { return name_; }
+
+	private:
+		std::string name_;
+	};
+
+	enum class Layout { sequential, shuffled };
+
+	const char* to_string(Layout layout) { return layout == Layout::sequential ? "sequential" : "shuffled"; }
+
+	using PtrVector = std::vector<Object*>;
+	using Wrapper = range_of_ptrs::raii_ptrs_container_wrapper<PtrVector>;
+	using Clock = std::chrono::steady_clock;
+
+
+	// Allocates `count` objects with values in [0, count / 4) so that Unique and Remove have work to do.
+	// With the shuffled layout walking the range chases pointers across the heap,
+	// with the sequential one the pointees are visited in allocation order.
+	PtrVector MakeRange(std::size_t count, Layout layout, std::mt19937& gen)
+	{
+		std::uniform_int_distribution<int> dist(0, static_cast<int>(std::max<std::size_t>(count / 4, 1)));
+
+		PtrVector result;
+		result.reserve(count);
+		for (std::size_t i = 0; i < count; ++i)
+			result.push_back(new Object(dist(gen)));
+
+		if (layout == Layout::shuffled)
+			std::shuffle(std::begin(result), std::end(result), gen);
+		return result;
+	}
+
+	using NamedVector = std::vector<Named*>;
+
+	// Names of 16 to 31 lowercase letters drawn from count / 4 distinct ones, laid out like MakeRange.
+	NamedVector MakeNames(std::size_t count, Layout layout, std::mt19937& gen)
+	{
+		std::uniform_int_distribution<unsigned> dist(0, static_cast<unsigned>(std::max<std::size_t>(count / 4, 1)));
+
+		NamedVector result;
+		result.reserve(count);
+		for (std::size_t i = 0; i < count; ++i) {
+			std::mt19937 letters(dist(gen));
+			std::string name(16 + letters() % 16, 'a');
+			for (char& c : name)
+				c = static_cast<char>('a' + letters() % 26);
+			result.push_back(new Named(std::move(name)));
+		}
+
+		if (layout == Layout::shuffled)
+			std::shuffle(std::begin(result), std::end(result), gen);
+		return result;
+	}
+
+	PtrVector MakeDefaultRange(std::size_t count)
+	{
+		PtrVector result;
+		result.reserve(count);
+		for (std::size_t i = 0; i < count; ++i)
+			result.push_back(new Object());
+		return result;
+	}
+
+	template<typename Func>
+	double TimeIt(Func func)
+	{
+		const auto start = Clock::now();
+		func();
+		const auto finish = Clock::now();
+		return std::chrono::duration<double, std::nano>(finish - start).count();
+	}
+
+	// Every case builds its own input, times only the algorithm call and returns the elapsed nanoseconds.
+	struct Case {
+		const char* name;
+		std::function<double(std::size_t, Layout, std::mt19937&)> run;
+	};
+
+	const auto isEven = [](const Object& obj) { return obj.getValue() % 2 == 0; };
+
+	// Selectivity in tenths, for the CopyIf / CloneIf variants.
+	template<int Tenths>
+	bool Selected(const Object& obj) { return obj.getValue() % 10 < Tenths; }
+
+	template<typename Tag, int Tenths>
+	double RunCopyIf(std::size_t n, Layout layout, std::mt19937& gen)
+	{
+		PtrVector src = MakeRange(n, layout, gen); Wrapper srcOwner{ src };
+		PtrVector dst = MakeDefaultRange(n); Wrapper dstOwner{ dst };
+		return TimeIt([&] { range_of_ptrs::CopyIf(Tag{}, std::begin(src), std::end(src), std::begin(dst), Selected<Tenths>); });
+	}
+
+	const Case cases[] = {
+		{ "Copy", [](std::size_t n, Layout layout, std::mt19937& gen) {
+			PtrVector src = MakeRange(n, layout, gen); Wrapper srcOwner{ src };
+			PtrVector dst = MakeDefaultRange(n); Wrapper dstOwner{ dst };
+			return TimeIt([&] { range_of_ptrs::Copy(std::begin(src), std::end(src), std::begin(dst)); });
+		} },
+		{ "CopyN", [](std::size_t n, Layout layout, std::mt19937& gen) {
+			PtrVector src = MakeRange(n, layout, gen); Wrapper srcOwner{ src };
+			PtrVector dst = MakeDefaultRange(n); Wrapper dstOwner{ dst };
+			return TimeIt([&] { range_of_ptrs::CopyN(std::begin(src), n, std::begin(dst)); });
+		} },
+		{ "CopyBackward", [](std::size_t n, Layout layout, std::mt19937& gen) {
+			PtrVector src = MakeRange(n, layout, gen); Wrapper srcOwner{ src };
+			PtrVector dst = MakeDefaultRange(n); Wrapper dstOwner{ dst };
+			return TimeIt([&] { range_of_ptrs::CopyBackward(std::begin(src), std::end(src), std::end(dst)); });
+		} },
+		{ "CopyIf", [](std::size_t n, Layout layout, std::mt19937& gen) {
+			PtrVector src = MakeRange(n, layout, gen); Wrapper srcOwner{ src };
+			PtrVector dst = MakeDefaultRange(n); Wrapper dstOwner{ dst };
+			return TimeIt([&] { range_of_ptrs::CopyIf(std::begin(src), std::end(src), std::begin(dst), isEven); });
+		} },
+		{ "CopyIf10", RunCopyIf<range_of_ptrs::assume_non_null_t, 1> },
+		{ "CopyIf90", RunCopyIf<range_of_ptrs::assume_non_null_t, 9> },
+		{ "CopyIfBranchless10", RunCopyIf<range_of_ptrs::branchless_t, 1> },
+		{ "CopyIfBranchless50", RunCopyIf<range_of_ptrs::branchless_t, 5> },
+		{ "CopyIfBranchless90", RunCopyIf<range_of_ptrs::branchless_t, 9> },
+		// Two filters in a row: copying after each one, or selecting and copying once at the end.
+		{ "FilterTwiceEager", [](std::size_t n, Layout layout, std::mt19937& gen) {
+			PtrVector src = MakeRange(n, layout, gen); Wrapper srcOwner{ src };
+			PtrVector dst; Wrapper dstOwner{ dst };
+			return TimeIt([&] {
+				const PtrVector evens = range_of_ptrs::CopyIfToContainer<PtrVector>(std::begin(src), std::end(src), isEven);
+				Wrapper evensOwner{ evens };
+				dst = range_of_ptrs::CopyIfToContainer<PtrVector>(std::begin(evens), std::end(evens), Selected<5>);
+			});
+		} },
+		{ "FilterTwiceSelect", [](std::size_t n, Layout layout, std::mt19937& gen) {
+			PtrVector src = MakeRange(n, layout, gen); Wrapper srcOwner{ src };
+			PtrVector dst; Wrapper dstOwner{ dst };
+			return TimeIt([&] {
+				const auto evens = range_of_ptrs::Select(std::begin(src), std::end(src), isEven);
+				dst = range_of_ptrs::MaterializeDeepCopy<PtrVector>(std::begin(src), range_of_ptrs::Refine(evens, std::begin(src), Selected<5>));
+			});
+		} },
+		{ "ReplaceCopy", [](std::size_t n, Layout layout, std::mt19937& gen) {
+			PtrVector src = MakeRange(n, layout, gen); Wrapper srcOwner{ src };
+			PtrVector dst = MakeDefaultRange(n); Wrapper dstOwner{ dst };
+			return TimeIt([&] { range_of_ptrs::ReplaceCopy(std::begin(src), std::end(src), std::begin(dst)); });
+		} },
+		{ "Clone", [](std::size_t n, Layout layout, std::mt19937& gen) {
+			PtrVector src = MakeRange(n, layout, gen); Wrapper srcOwner{ src };
+			// Clone overwrites the live destination objects without deleting them.
+			PtrVector dst = MakeDefaultRange(n); Wrapper dstOwner{ dst };
+			const PtrVector overwritten = dst; Wrapper overwrittenOwner{ overwritten };
+			return TimeIt([&] { range_of_ptrs::Clone(std::begin(src), std::end(src), std::begin(dst)); });
+		} },
+		{ "CloneIf", [](std::size_t n, Layout layout, std::mt19937& gen) {
+			PtrVector src = MakeRange(n, layout, gen); Wrapper srcOwner{ src };
+			PtrVector dst; Wrapper dstOwner{ dst };
+			dst.reserve(n);
+			return TimeIt([&] { range_of_ptrs::CloneIf(std::begin(src), std::end(src), std::back_inserter(dst), isEven); });
+		} },
+		{ "CloneIfBranchless", [](std::size_t n, Layout layout, std::mt19937& gen) {
+			PtrVector src = MakeRange(n, layout, gen); Wrapper srcOwner{ src };
+			PtrVector dst; Wrapper dstOwner{ dst };
+			dst.reserve(n);
+			return TimeIt([&] { range_of_ptrs::CloneIf(range_of_ptrs::branchless, std::begin(src), std::end(src), std::back_inserter(dst), isEven); });
+		} },
+		{ "ReplaceClone", [](std::size_t n, Layout layout, std::mt19937& gen) {
+			PtrVector src = MakeRange(n, layout, gen); Wrapper srcOwner{ src };
+			PtrVector dst = MakeDefaultRange(n); Wrapper dstOwner{ dst };
+			return TimeIt([&] { range_of_ptrs::ReplaceClone(std::begin(src), std::end(src), std::begin(dst)); });
+		} },
+		{ "Remove", [](std::size_t n, Layout layout, std::mt19937& gen) {
+			PtrVector src = MakeRange(n, layout, gen); Wrapper srcOwner{ src };
+			const Object value{ 0 };
+			return TimeIt([&] { src.erase(range_of_ptrs::Remove(std::begin(src), std::end(src), value), std::end(src)); });
+		} },
+		{ "RemoveTagged", [](std::size_t n, Layout layout, std::mt19937& gen) {
+			PtrVector objects = MakeRange(n, layout, gen);
+			const auto fingerprint = [](const Object& obj) { return range_of_ptrs::FingerprintTag(std::hash<int>()(obj.getValue())); };
+			auto src = range_of_ptrs::TagRange(std::begin(objects), std::end(objects), fingerprint);
+			range_of_ptrs::raii_ptrs_range_wrapper<range_of_ptrs::untagged_iterator<decltype(src)::iterator>> srcOwner;
+			const Object value{ 0 };
+			const double elapsed = TimeIt([&] { src.erase(range_of_ptrs::RemoveTagged(std::begin(src), std::end(src), value, fingerprint(value)), std::end(src)); });
+			srcOwner.update_range(range_of_ptrs::MakeUntagged(std::begin(src)), range_of_ptrs::MakeUntagged(std::end(src)));
+			return elapsed;
+		} },
+		{ "RemoveIf", [](std::size_t n, Layout layout, std::mt19937& gen) {
+			PtrVector src = MakeRange(n, layout, gen); Wrapper srcOwner{ src };
+			return TimeIt([&] { src.erase(range_of_ptrs::RemoveIf(std::begin(src), std::end(src), 0, isEven), std::end(src)); });
+		} },
+		{ "SortUnique", [](std::size_t n, Layout layout, std::mt19937& gen) {
+			PtrVector src = MakeRange(n, layout, gen); Wrapper srcOwner{ src };
+			return TimeIt([&] {
+				std::sort(std::begin(src), std::end(src), range_of_ptrs::BinaryFunctorDerefPtrsAdapter<std::less<>>());
+				src.erase(range_of_ptrs::Unique(std::begin(src), std::end(src), std::equal_to<>()), std::end(src));
+			});
+		} },
+		{ "StableSortByKey", [](std::size_t n, Layout layout, std::mt19937& gen) {
+			PtrVector src = MakeRange(n, layout, gen); Wrapper srcOwner{ src };
+			PtrVector order;
+			return TimeIt([&] {
+				order = src;
+				std::stable_sort(std::begin(order), std::end(order), range_of_ptrs::BinaryFunctorDerefPtrsAdapter<std::less<>>());
+			});
+		} },
+		{ "ArgSortByKey", [](std::size_t n, Layout layout, std::mt19937& gen) {
+			PtrVector src = MakeRange(n, layout, gen); Wrapper srcOwner{ src };
+			std::vector<std::uint32_t> order;
+			return TimeIt([&] { order = range_of_ptrs::ArgSortByKey(std::begin(src), std::end(src), [](const Object& obj) { return obj.getValue(); }); });
+		} },
+		{ "SortUniqueStrings", [](std::size_t n, Layout layout, std::mt19937& gen) {
+			NamedVector src = MakeNames(n, layout, gen); range_of_ptrs::raii_ptrs_container_wrapper<NamedVector> srcOwner{ src };
+			return TimeIt([&] {
+				std::sort(std::begin(src), std::end(src), range_of_ptrs::BinaryFunctorDerefPtrsAdapter<std::less<>>());
+				src.erase(range_of_ptrs::Unique(std::begin(src), std::end(src), std::equal_to<>()), std::end(src));
+			});
+		} },
+		{ "SortUniqueAbbrev", [](std::size_t n, Layout layout, std::mt19937& gen) {
+			NamedVector src = MakeNames(n, layout, gen); range_of_ptrs::raii_ptrs_container_wrapper<NamedVector> srcOwner{ src };
+			const auto abbreviate = [](const Named& obj) { return range_of_ptrs::AbbreviateString(obj.getName()); };
+			return TimeIt([&] { src.erase(range_of_ptrs::SortUniqueAbbreviated(std::begin(src), std::end(src), abbreviate), std::end(src)); });
+		} },
+		{ "DeepCopy", [](std::size_t n, Layout layout, std::mt19937& gen) {
+			PtrVector src = MakeRange(n, layout, gen); Wrapper srcOwner{ src };
+			PtrVector dst; Wrapper dstOwner{ dst };
+			return TimeIt([&] { dst = range_of_ptrs::DeepCopy(src); });
+		} },
+		{ "DeepCopyAliased", [](std::size_t n, Layout layout, std::mt19937& gen) {
+			// Every object is referenced from four slots.
+			PtrVector objects = MakeRange(n / 4, layout, gen); Wrapper objectsOwner{ objects };
+			PtrVector src;
+			for (int i = 0; i < 4; ++i)
+				src.insert(std::end(src), std::begin(objects), std::end(objects));
+			std::shuffle(std::begin(src), std::end(src), gen);
+			PtrVector dst; range_of_ptrs::raii_ptrs_aliased_container_wrapper<PtrVector> dstOwner{ dst };
+			return TimeIt([&] { dst = range_of_ptrs::DeepCopy(range_of_ptrs::preserve_aliasing, src); });
+		} },
+		{ "WrapperDestruction", [](std::size_t n, Layout layout, std::mt19937& gen) {
+			PtrVector src = MakeRange(n, layout, gen);
+			return TimeIt([&] { Wrapper owner{ src }; });
+		} },
+	};
+
+
+	struct Result {
+		const char* algorithm;
+		Layout layout;
+		std::size_t size;
+		double nsPerElement;
+	};
+
+	void WriteJson(const char* path, const std::vector<Result>& results, int repetitions)
+	{
+		std::FILE* file = std::fopen(path, "w");
+		if (file == nullptr) {
+			std::fprintf(stderr, "can not open %s\n", path);
+			std::exit(1);
+		}
+
+		std::fprintf(file, "{\n\t\"repetitions\": %d,\n\t\"benchmarks\": [\n", repetitions);
+		for (std::size_t i = 0; i < results.size(); ++i) {
+			const auto& r = results[i];
+			std::fprintf(file,
+				"\t\t{ \"algorithm\": \"%s\", \"layout\": \"%s\", \"size\": %zu, \"ns_per_element\": %.4f, \"elements_per_second\": %.1f }%s\n",
+				r.algorithm, to_string(r.layout), r.size, r.nsPerElement, 1e9 / r.nsPerElement,
+				i + 1 == results.size() ? "" : ",");
+		}
+		std::fprintf(file, "\t]\n}\n");
+		std::fclose(file);
+	}
+}
+
+
+int main(int argc, char* argv[])
+{
+	using namespace bench;
+
+	// usage: range_of_ptrs_benchmark [filter] [repetitions] [--json file]
+	const char* filter = "";
+	int repetitions = 5;
+	const char* jsonPath = nullptr;
+
+	int positional = 0;
+	for (int i = 1; i < argc; ++i) {
+		if (std::strcmp(argv[i], "--json") == 0 && i + 1 < argc)
+			jsonPath = argv[++i];
+		else if (positional++ == 0)
+			filter = argv[i];
+		else
+			repetitions = std::max(1, std::atoi(argv[i]));
+	}
+
+	const std::size_t sizes[] = { 1u << 10, 1u << 14, 1u << 18, 1u << 20 };
+	const Layout layouts[] = { Layout::sequential, Layout::shuffled };
+
+	std::vector<Result> results;
+	std::printf("%-20s %-10s %10s %14s\n", "algorithm", "layout", "size", "ns/element");
+	for (const auto& c : cases) {
+		if (std::strstr(c.name, filter) == nullptr)
+			continue;
+
+		for (auto layout : layouts) {
+			for (auto n : sizes) {
+				std::mt19937 gen(static_cast<std::mt19937::result_type>(n));
+				double best = c.run(n, layout, gen);
+				for (int i = 1; i < repetitions; ++i)
+					best = std::min(best, c.run(n, layout, gen));
+
+				results.push_back({ c.name, layout, n, best / static_cast<double>(n) });
+				std::printf("%-20s %-10s %10zu %14.3f\n", c.name, to_string(layout), n, results.back().nsPerElement);
+			}
+		}
+	}
+
+	if (jsonPath != nullptr)
+		WriteJson(jsonPath, results, repetitions);
+
+#ifdef RANGE_OF_PTRS_PERF_COUNTERS
+	std::printf("\nhardware counters (%s)\n", range_of_ptrs::perf::available() ? "perf_event_open" : "unavailable");
+	range_of_ptrs::perf::report(std::cout);
+#endif
+
+	return 0;
+}
@@ -0,0 +1,83 @@
+#include "ExternalSort.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+
+namespace bench
+{
+	// 64 byte record: a key drawn from a range of a quarter of the record count, so Unique has work to do.
+	struct Record {
+		std::uint64_t key;
+		char payload[56];
+
+		bool operator< (const Record& other) const noexcept { return key < other.key; }
+		bool operator==(const Record& other) const noexcept { return key == other.key; }
+	};
+
+	using Clock = std::chrono::steady_clock;
+
+	double Seconds(Clock::time_point start) { return std::chrono::duration<double>(Clock::now() - start).count(); }
+
+	// Writes `count` random records as a serialized range without holding them in memory.
+	void GenerateInput(int fd, std::uint64_t count)
+	{
+		std::mt19937_64 gen(42);
+		std::uniform_int_distribution<std::uint64_t> dist(0, std::max<std::uint64_t>(count / 4, 1));
+
+		const range_of_ptrs::serialized_header header = range_of_ptrs::MakeSerializedHeader<Record>(count);
+		const std::vector<char> padding(header.data_offset - sizeof(header));
+		range_of_ptrs::detail::PwriteAll(fd, &header, sizeof(header), 0);
+		range_of_ptrs::detail::PwriteAll(fd, padding.data(), padding.size(), sizeof(header));
+
+		std::vector<Record> chunk(1 << 16);
+		std::uint64_t offset = header.data_offset;
+		for (std::uint64_t left = count; left != 0;) {
+			const auto n = static_cast<std::size_t>(std::min<std::uint64_t>(left, chunk.size()));
+			for (std::size_t i = 0; i < n; ++i)
+				chunk[i] = Record{ dist(gen), {} };
+			range_of_ptrs::detail::PwriteAll(fd, chunk.data(), n * sizeof(Record), offset);
+			offset += n * sizeof(Record);
+			left -= n;
+		}
+	}
+}
+
+
+int main(int argc, char* argv[])
+{
+	using namespace bench;
+
+	// usage: range_of_ptrs_external_sort_benchmark [gigabytes] [memory MiB] [temp dir]
+	const double gigabytes = argc > 1 ? std::atof(argv[1]) : 4.0;
+	const std::size_t memoryMiB = argc > 2 ? static_cast<std::size_t>(std::atoll(argv[2])) : 256;
+	const std::string dir = argc > 3 ? argv[3] : "";
+
+	range_of_ptrs::external_sort_options options;
+	options.memory_bytes = memoryMiB << 20;
+	options.temp_dir = dir;
+
+	const auto count = static_cast<std::uint64_t>(gigabytes * (1ull << 30) / sizeof(Record));
+	range_of_ptrs::detail::temp_file input{ dir };
+	range_of_ptrs::detail::temp_file output{ dir };
+
+	auto start = Clock::now();
+	GenerateInput(input.fd(), count);
+	std::printf("generated %llu records (%.2f GiB) in %.2f s\n", static_cast<unsigned long long>(count), gigabytes, Seconds(start));
+
+	start = Clock::now();
+	const auto result = range_of_ptrs::ExternalSortUniqueFile<Record>(input.fd(), output.fd(), std::less<>(), std::equal_to<>(), options);
+	const double elapsed = Seconds(start);
+
+	std::printf("sorted with %zu MiB: %llu unique records in %.2f s, %.1f MiB/s, %.1f ns/record\n",
+		memoryMiB, static_cast<unsigned long long>(result.written), elapsed,
+		static_cast<double>(count * sizeof(Record)) / (1 << 20) / elapsed, elapsed * 1e9 / static_cast<double>(count));
+	return 0;
+}
@@ -0,0 +1,67 @@
+#!/usr/bin/env python3
+"""Compares benchmark results with a stored baseline.
+
+usage: compare.py CURRENT.json BASELINE.json [--threshold PERCENT] [--update]
+
+Both files are written by `range_of_ptrs_benchmark --json FILE`. A case regresses
+when its ns/element grows by more than the threshold (default 10 %) over the
+baseline. The exit status is 1 if any case regressed. With --update the
+baseline is replaced by the current results instead.
+"""
+
+import argparse
+import json
+import shutil
+import sys
+
+
+def load(path):
+    with open(path) as f:
+        data = json.load(f)
+    return {(b["algorithm"], b["layout"], b["size"]): b["ns_per_element"] for b in data["benchmarks"]}
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("current")
+    parser.add_argument("baseline")
+    parser.add_argument("--threshold", type=float, default=10.0, help="allowed slowdown in percent")
+    parser.add_argument("--update", action="store_true", help="overwrite the baseline with the current results")
+    args = parser.parse_args()
+
+    if args.update:
+        shutil.copyfile(args.current, args.baseline)
+        print(f"baseline {args.baseline} updated")
+        return 0
+
+    current = load(args.current)
+    baseline = load(args.baseline)
+
+    regressions = 0
+    print(f"{'algorithm':<20} {'layout':<10} {'size':>10} {'base ns/el':>12} {'now ns/el':>12} {'change':>9}")
+    for key in sorted(current):
+        algorithm, layout, size = key
+        now = current[key]
+        if key not in baseline:
+            print(f"{algorithm:<20} {layout:<10} {size:>10} {'-':>12} {now:>12.3f} {'new':>9}")
+            continue
+
+        base = baseline[key]
+        change = (now / base - 1.0) * 100.0
+        regressed = change > args.threshold
+        regressions += regressed
+        print(f"{algorithm:<20} {layout:<10} {size:>10} {base:>12.3f} {now:>12.3f} {change:>+8.1f}%{'  REGRESSION' if regressed else ''}")
+
+    for key in sorted(set(baseline) - set(current)):
+        print(f"{key[0]:<20} {key[1]:<10} {key[2]:>10} missing from current results")
+
+    if regressions:
+        print(f"\n{regressions} case(s) regressed by more than {args.threshold:g}%")
+        return 1
+
+    print(f"\nno regressions above {args.threshold:g}%")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,90 @@
+#!/usr/bin/env bash
+# Profile-guided optimization pipeline for the algorithm benchmarks.
+#
+#   1. builds the benchmark with the `native` preset (reference build)
+#   2. builds it instrumented with the `pgo-generate` preset
+#   3. runs the training workloads to collect a profile
+#   4. rebuilds the same tree with the `pgo-use` preset
+#   5. runs reference and PGO builds and prints the speedup per algorithm
+#
+# usage: benchmarks/pgo.sh [repetitions]
+#
+# CC/CXX select the compiler as usual. Clang profiles are merged with
+# llvm-profdata (override with LLVM_PROFDATA=...).
+
+set -euo pipefail
+
+REPETITIONS="${1:-5}"
+SOURCE_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")/.." && pwd)"
+BUILD_DIR="${SOURCE_DIR}/build"
+PROFILE_DIR="${BUILD_DIR}/pgo-profiles"
+BENCHMARK=range_of_ptrs_benchmark
+
+# Representative workloads: sort + Unique as in main.cpp, deep copy,
+# clone churn (Clone, CloneIf, ReplaceClone) and the predicate driven
+# CopyIf / RemoveIf. Code that is never executed during training is
+# treated as cold and optimized for size, so algorithms outside this list
+# are expected to lose performance in the PGO build.
+TRAINING_WORKLOADS=(SortUnique DeepCopy Clone CopyIf RemoveIf)
+
+cd "${SOURCE_DIR}"
+
+echo "== reference build (native)"
+cmake --preset native >/dev/null
+cmake --build --preset native --target "${BENCHMARK}"
+
+echo "== instrumented build (pgo-generate)"
+rm -rf "${PROFILE_DIR}"
+mkdir -p "${PROFILE_DIR}"
+cmake --preset pgo-generate >/dev/null
+cmake --build --preset pgo-generate --target "${BENCHMARK}"
+
+echo "== training"
+for workload in "${TRAINING_WORKLOADS[@]}"; do
+	"${BUILD_DIR}/pgo/${BENCHMARK}" "${workload}" 1 >/dev/null
+done
+
+COMPILER_ID="$(sed -n 's/^CMAKE_CXX_COMPILER_ID:[A-Z]*=//p' "${BUILD_DIR}/pgo/CMakeCache.txt")"
+if [[ -z "${COMPILER_ID}" ]]; then
+	COMPILER_ID="$("${CXX:-c++}" --version | grep -qi clang && echo Clang || echo GNU)"
+fi
+if [[ "${COMPILER_ID}" == *Clang* ]]; then
+	"${LLVM_PROFDATA:-llvm-profdata}" merge -output="${PROFILE_DIR}/merged.profdata" "${PROFILE_DIR}"/*.profraw
+fi
+
+echo "== optimized build (pgo-use)"
+cmake --preset pgo-use >/dev/null
+cmake --build --preset pgo-use --target "${BENCHMARK}"
+
+echo "== measuring (${REPETITIONS} repetitions)"
+REFERENCE_OUT="$(mktemp)"
+PGO_OUT="$(mktemp)"
+trap 'rm -f "${REFERENCE_OUT}" "${PGO_OUT}"' EXIT
+
+"${BUILD_DIR}/native/${BENCHMARK}" "" "${REPETITIONS}" >"${REFERENCE_OUT}"
+"${BUILD_DIR}/pgo/${BENCHMARK}" "" "${REPETITIONS}" >"${PGO_OUT}"
+
+# Both outputs are "algorithm layout size ns/element" tables with a header line.
+awk '
+	FNR == 1 { next }
+	NR == FNR { reference[$1 " " $2 " " $3] = $4; next }
+	($1 " " $2 " " $3) in reference {
+		key = $1 " " $2 " " $3
+		speedup = reference[key] / $4
+		printf "%-20s %-10s %10s %12.3f %12.3f %9.2fx\n", $1, $2, $3, reference[key], $4, speedup
+		if (!($1 in count)) order[++algorithms] = $1
+		logsum[$1] += log(speedup)
+		count[$1]++
+	}
+	END {
+		print ""
+		printf "%-20s %10s\n", "algorithm", "geomean"
+		for (i = 1; i <= algorithms; ++i) {
+			name = order[i]
+			printf "%-20s %9.2fx\n", name, exp(logsum[name] / count[name])
+		}
+	}
+' "${REFERENCE_OUT}" "${PGO_OUT}" | {
+	printf "%-20s %-10s %10s %12s %12s %10s\n" "algorithm" "layout" "size" "ref ns/elem" "pgo ns/elem" "speedup"
+	cat
+}
@@ -0,0 +1,402 @@
+// Randomized checks of the file-backed code: MapSerialized (MappedLoad.hpp), the streaming
+// algorithms (StreamingCopy.hpp) and the external sort (ExternalSort.hpp).
+//
+// Ranges of random length are written with Serialize to a temporary file and read back through
+// the mapping; damaged files (truncated, too small, misaligned data) must be rejected with an
+// exception and leave the region untouched. The streaming algorithms run with small chunks on
+// sizes that are not multiples of the chunk, and must match their in-memory counterparts. The
+// external sort gets a memory budget of a few dozen objects, so it spills and merges several
+// runs, and must match std::stable_sort (+ std::unique).
+//
+// `range_of_ptrs_file_io [rounds] [seed]`
+
+#include "RangeOfPointers.hpp"
+#include "ExternalSort.hpp"
+#include "MappedLoad.hpp"
+#include "StreamingCopy.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#ifdef RANGE_OF_PTRS_HAS_POSIX_IO
+
+#include <fcntl.h>
+#include <unistd.h>
+
+
+#define FILE_CHECK(cond)                                                                   \
+	do {                                                                                   \
+		if (!(cond)) {                                                                     \
+			std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+			std::abort();                                                                  \
+		}                                                                                  \
+	} while (false)
+
+
+namespace fileio
+{
+	struct Record {
+		std::uint32_t key;
+		std::uint32_t seq;
+
+		bool operator==(const Record& other) const noexcept { return key == other.key && seq == other.seq; }
+	};
+
+	// Named temporary file, removed by the destructor.
+	class TempFile {
+	public:
+		TempFile()
+		{
+			const char* env = std::getenv("TMPDIR");
+			path_ = env != nullptr && *env != '\0' ? env : "/tmp";
+			path_ += "/range_of_ptrs_file_io-XXXXXX";
+			fd_ = ::mkstemp(path_.data());
+			if (fd_ < 0)
+				throw std::system_error(errno, std::generic_category(), "mkstemp");
+		}
+
+		TempFile(const TempFile&) = delete;
+		TempFile& operator=(const TempFile&) = delete;
+
+		~TempFile()
+		{
+			::close(fd_);
+			::unlink(path_.c_str());
+		}
+
+		int fd() const noexcept { return fd_; }
+		const char* path() const noexcept { return path_.c_str(); }
+
+		void truncate(std::uint64_t size) const { FILE_CHECK(::ftruncate(fd_, static_cast<off_t>(size)) == 0); }
+
+	private:
+		std::string path_;
+		int fd_ = -1;
+	};
+
+	std::vector<Record> MakeRecords(std::mt19937& gen, std::size_t count)
+	{
+		std::vector<Record> result(count);
+		for (std::size_t i = 0; i < count; ++i)
+			result[i] = Record{ static_cast<std::uint32_t>(gen() % 64), static_cast<std::uint32_t>(i) };
+		return result;
+	}
+
+	void WriteRecords(const TempFile& file, const std::vector<Record>& records)
+	{
+		std::vector<const Record*> ptrs;
+		for (const Record& record : records)
+			ptrs.push_back(&record);
+		range_of_ptrs::fd_sink sink{ file.fd() };
+		range_of_ptrs::Serialize(ptrs, sink);
+	}
+
+	range_of_ptrs::serialized_header ReadHeader(const TempFile& file)
+	{
+		range_of_ptrs::serialized_header header;
+		FILE_CHECK(::pread(file.fd(), &header, sizeof(header), 0) == sizeof(header));
+		return header;
+	}
+
+	void WriteHeader(const TempFile& file, const range_of_ptrs::serialized_header& header)
+	{
+		FILE_CHECK(::pwrite(file.fd(), &header, sizeof(header), 0) == sizeof(header));
+	}
+
+	template<typename Container>
+	bool MapRejected(const TempFile& file)
+	{
+		range_of_ptrs::mapped_region region;
+		try {
+			range_of_ptrs::MapSerialized<Container>(file.path(), region);
+		}
+		catch (const std::runtime_error&) {
+			FILE_CHECK(region.empty());
+			return true;
+		}
+		return false;
+	}
+
+	void CheckMapSerialized(std::mt19937& gen)
+	{
+		const std::vector<Record> records = MakeRecords(gen, gen() % 5000);
+
+		{
+			TempFile file;
+			WriteRecords(file, records);
+
+			// Read-only mapping: the pointees are the file contents.
+			range_of_ptrs::mapped_region region;
+			const auto loaded = range_of_ptrs::MapSerialized<std::vector<const Record*>>(file.path(), region, gen() % 2 == 0);
+			FILE_CHECK(loaded.size() == records.size());
+			FILE_CHECK(records.empty() || !region.empty());
+			for (std::size_t i = 0; i < records.size(); ++i)
+				FILE_CHECK(*loaded[i] == records[i]);
+
+			// Copy-on-write mapping: writes stay private to it. The wrapper empties the container
+			// before it unmaps.
+			if (!records.empty()) {
+				range_of_ptrs::mapped_region writable;
+				auto mutableLoaded = range_of_ptrs::MapSerialized<std::vector<Record*>>(file.path(), writable);
+				{
+					range_of_ptrs::raii_ptrs_mapping_wrapper<std::vector<Record*>> owner{ mutableLoaded, std::move(writable) };
+					FILE_CHECK(writable.empty());
+					for (Record* record : mutableLoaded)
+						record->key = ~record->key;
+					FILE_CHECK(mutableLoaded.front()->key == ~records.front().key);
+					FILE_CHECK(*loaded.front() == records.front());
+				}
+				FILE_CHECK(mutableLoaded.empty());
+			}
+
+			// release() hands the mapping back untouched.
+			{
+				range_of_ptrs::mapped_region mapping;
+				auto reloaded = range_of_ptrs::MapSerialized<std::vector<const Record*>>(file.path(), mapping);
+				{
+					range_of_ptrs::raii_ptrs_mapping_wrapper<std::vector<const Record*>> owner{ reloaded, std::move(mapping) };
+					mapping = owner.release();
+				}
+				FILE_CHECK(reloaded.size() == records.size() && !mapping.empty());
+				for (std::size_t i = 0; i < records.size(); ++i)
+					FILE_CHECK(*reloaded[i] == records[i]);
+			}
+		}
+
+		// A valid header with the objects placed at a smaller, still aligned offset.
+		{
+			TempFile file;
+			auto header = range_of_ptrs::MakeSerializedHeader<Record>(records.size());
+			header.data_offset = sizeof(header) + alignof(Record);
+			WriteHeader(file, header);
+			if (!records.empty())
+				FILE_CHECK(::pwrite(file.fd(), records.data(), records.size() * sizeof(Record), static_cast<off_t>(header.data_offset)) > 0);
+
+			range_of_ptrs::mapped_region region;
+			const auto loaded = range_of_ptrs::MapSerialized<std::vector<const Record*>>(file.path(), region);
+			FILE_CHECK(loaded.size() == records.size());
+			for (std::size_t i = 0; i < records.size(); ++i)
+				FILE_CHECK(*loaded[i] == records[i]);
+		}
+
+		// Truncated object data: anything from one byte to every object missing.
+		if (!records.empty()) {
+			TempFile file;
+			WriteRecords(file, records);
+			const std::uint64_t dataOffset = ReadHeader(file).data_offset;
+			file.truncate(dataOffset + gen() % (records.size() * sizeof(Record)));
+			FILE_CHECK(MapRejected<std::vector<const Record*>>(file));
+			FILE_CHECK(MapRejected<std::vector<Record*>>(file));
+		}
+
+		// A file shorter than the header, and one cut inside the padding.
+		{
+			TempFile file;
+			WriteRecords(file, records);
+			file.truncate(gen() % sizeof(range_of_ptrs::serialized_header));
+			FILE_CHECK(MapRejected<std::vector<const Record*>>(file));
+		}
+		{
+			TempFile file;
+			WriteRecords(file, records);
+			const std::uint64_t dataOffset = ReadHeader(file).data_offset;
+			file.truncate(sizeof(range_of_ptrs::serialized_header) + gen() % (dataOffset - sizeof(range_of_ptrs::serialized_header)));
+			FILE_CHECK(MapRejected<std::vector<const Record*>>(file));
+		}
+
+		// data_offset inside the accepted range, but not a multiple of the object alignment.
+		{
+			TempFile file;
+			WriteRecords(file, records);
+			auto header = ReadHeader(file);
+			do {
+				header.data_offset = sizeof(header) + gen() % (range_of_ptrs::serializedMaxDataOffset - sizeof(header));
+			} while (header.data_offset % alignof(Record) == 0);
+			WriteHeader(file, header);
+			FILE_CHECK(MapRejected<std::vector<const Record*>>(file));
+			FILE_CHECK(MapRejected<std::vector<Record*>>(file));
+		}
+	}
+
+	std::vector<Record> MapRecords(const TempFile& file)
+	{
+		range_of_ptrs::mapped_region region;
+		std::vector<Record> result;
+		for (const Record* record : range_of_ptrs::MapSerialized<std::vector<const Record*>>(file.path(), region))
+			result.push_back(*record);
+		return result;
+	}
+
+	void CheckStreaming(std::mt19937& gen)
+	{
+		// Chunks of 2..64 objects, sometimes with a partial object left over in chunk_bytes,
+		// and an input that ends inside a chunk.
+		const std::size_t chunk = 2 + gen() % 63;
+		range_of_ptrs::stream_options options;
+		options.chunk_bytes = chunk * sizeof(Record) + gen() % sizeof(Record);
+		const std::size_t count = gen() % 16 == 0 ? 0 : chunk * (gen() % 40) + 1 + gen() % (chunk - 1);
+
+		const std::vector<Record> records = MakeRecords(gen, count);
+		std::vector<const Record*> ptrs;
+		for (const Record& record : records)
+			ptrs.push_back(&record);
+
+		TempFile input;
+		WriteRecords(input, records);
+
+		// The output starts out longer than any result, so it must be truncated.
+		auto runOn = [&](auto algorithm) {
+			TempFile output;
+			const std::vector<char> junk((count + 1) * sizeof(Record) + range_of_ptrs::serializedMaxDataOffset, 'x');
+			FILE_CHECK(::pwrite(output.fd(), junk.data(), junk.size(), 0) == static_cast<ssize_t>(junk.size()));
+
+			const range_of_ptrs::stream_result result = algorithm(input.fd(), output.fd());
+			FILE_CHECK(result.read == count);
+			const std::vector<Record> written = MapRecords(output);
+			FILE_CHECK(result.written == written.size());
+			FILE_CHECK(::lseek(output.fd(), 0, SEEK_END) == static_cast<off_t>(ReadHeader(output).data_offset + written.size() * sizeof(Record)));
+			return written;
+		};
+
+		{
+			const auto written = runOn([&](int in, int out) { return range_of_ptrs::StreamDeepCopy<Record>(in, out, options); });
+			FILE_CHECK(written == records);
+		}
+
+		{
+			const std::uint32_t modulus = 2 + gen() % 5;
+			const auto keep = [modulus](const Record& record) { return record.key % modulus != 0; };
+
+			std::vector<Record> storage(count);
+			std::vector<Record*> dest;
+			for (Record& record : storage)
+				dest.push_back(&record);
+			const auto destEnd = range_of_ptrs::CopyIf(std::begin(ptrs), std::end(ptrs), std::begin(dest), keep);
+			storage.resize(static_cast<std::size_t>(destEnd - std::begin(dest)));
+
+			const auto written = runOn([&](int in, int out) { return range_of_ptrs::StreamCopyIf<Record>(in, out, keep, options); });
+			FILE_CHECK(written == storage);
+		}
+
+		{
+			// Only four classes of keys, so equal neighbours are frequent and straddle chunk boundaries.
+			const auto sameKey = [](const Record& lhs, const Record& rhs) { return lhs.key / 16 == rhs.key / 16; };
+
+			std::vector<Record*> owned;
+			for (const Record& record : records)
+				owned.push_back(RANGE_OF_PTRS_TRACK(new Record(record)));
+			owned.erase(range_of_ptrs::Unique(std::begin(owned), std::end(owned), sameKey), std::end(owned));
+			std::vector<Record> expected;
+			for (Record* record : owned) {
+				expected.push_back(*record);
+				RANGE_OF_PTRS_DELETE(record, "CheckStreaming");
+			}
+
+			const auto written = runOn([&](int in, int out) { return range_of_ptrs::StreamUnique<Record>(in, out, sameKey, options); });
+			FILE_CHECK(written == expected);
+		}
+	}
+
+	void CheckExternalSort(std::mt19937& gen)
+	{
+		// run_builder holds memory_bytes / (sizeof(T) + sizeof(T*)) objects per run.
+		const std::size_t runLength = 8 + gen() % 57;
+		range_of_ptrs::external_sort_options options;
+		options.memory_bytes = runLength * (sizeof(Record) + sizeof(Record*));
+		const std::size_t count = gen() % 8 == 0 ? gen() % (runLength + 1) : runLength * (2 + gen() % 20) + gen() % runLength;
+
+		// Keys in [0, 64) and seq the input position, so the order among equal keys is visible.
+		const std::vector<Record> records = MakeRecords(gen, count);
+		std::vector<const Record*> ptrs;
+		for (const Record& record : records)
+			ptrs.push_back(&record);
+
+		TempFile input;
+		WriteRecords(input, records);
+
+		const auto byKey = [](const Record& lhs, const Record& rhs) { return lhs.key < rhs.key; };
+		const auto sameKey = [](const Record& lhs, const Record& rhs) { return lhs.key == rhs.key; };
+		const auto never = [](const Record&, const Record&) { return false; };
+
+		std::vector<Record> sorted = records;
+		std::stable_sort(std::begin(sorted), std::end(sorted), byKey);
+		std::vector<Record> unique = sorted;
+		unique.erase(std::unique(std::begin(unique), std::end(unique), sameKey), std::end(unique));
+
+		auto inMemory = [&](auto pred) {
+			auto owned = range_of_ptrs::ExternalSortUnique<std::vector<Record*>>(std::begin(ptrs), std::end(ptrs), byKey, pred, options);
+			std::vector<Record> result;
+			for (Record* record : owned) {
+				result.push_back(*record);
+				RANGE_OF_PTRS_DELETE(record, "CheckExternalSort");
+			}
+			return result;
+		};
+
+		auto fileToFile = [&](auto pred) {
+			TempFile output;
+			const range_of_ptrs::stream_result result = range_of_ptrs::ExternalSortUniqueFile<Record>(input.fd(), output.fd(), byKey, pred, options);
+			FILE_CHECK(result.read == count);
+			const std::vector<Record> written = MapRecords(output);
+			FILE_CHECK(result.written == written.size());
+			return written;
+		};
+
+		FILE_CHECK(inMemory(never) == sorted);
+		FILE_CHECK(inMemory(sameKey) == unique);
+		FILE_CHECK(fileToFile(never) == sorted);
+		FILE_CHECK(fileToFile(sameKey) == unique);
+	}
+
+	void CheckMissingFile()
+	{
+		range_of_ptrs::mapped_region region;
+		bool thrown = false;
+		try {
+			range_of_ptrs::MapSerialized<std::vector<const Record*>>("/nonexistent/range_of_ptrs", region);
+		}
+		catch (const std::system_error&) {
+			thrown = true;
+		}
+		FILE_CHECK(thrown && region.empty());
+	}
+}
+
+
+int main(int argc, char* argv[])
+{
+	const long rounds = argc > 1 ? std::atol(argv[1]) : 200;
+	const unsigned seed = argc > 2 ? static_cast<unsigned>(std::atol(argv[2])) : 1;
+
+	std::mt19937 gen(seed);
+	fileio::CheckMissingFile();
+	for (long i = 0; i < rounds; ++i) {
+		fileio::CheckMapSerialized(gen);
+		fileio::CheckStreaming(gen);
+		fileio::CheckExternalSort(gen);
+#ifdef RANGE_OF_PTRS_OWNERSHIP_TRACKING
+		FILE_CHECK(range_of_ptrs::ownership::violations().empty());
+		FILE_CHECK(range_of_ptrs::ownership::live_count() == 0);
+#endif
+	}
+
+	std::printf("%ld rounds passed (seed %u)\n", rounds, seed);
+	return 0;
+}
+
+#else
+
+int main()
+{
+	std::printf("file I/O checks need POSIX, skipped\n");
+	return 0;
+}
+
+#endif // RANGE_OF_PTRS_HAS_POSIX_IO
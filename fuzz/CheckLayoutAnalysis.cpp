@@ -0,0 +1,196 @@
+// Checks of AnalyzeLayout (LayoutAnalysis.hpp) on ranges with a known layout.
+//
+// Pointers into one pool are laid out sequentially, with nulls, with repeated pointers, shuffled
+// over a dense block and shuffled over a block 64 times the range; every layout is analyzed in
+// full and sampled, and must get its recommendation and the expected fractions.
+//
+// `range_of_ptrs_layout [seed]`
+
+#include "LayoutAnalysis.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+
+#define LAYOUT_CHECK(cond)                                                                 \
+	do {                                                                                   \
+		if (!(cond)) {                                                                     \
+			std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+			std::abort();                                                                  \
+		}                                                                                  \
+	} while (false)
+
+
+namespace layout
+{
+	// One cache line, 64 to a page.
+	struct alignas(64) Line {
+		char bytes[64];
+	};
+
+	constexpr std::size_t elements = 4096;
+	constexpr std::size_t spacing = 64;           // scattered layouts use one pointee per page
+	constexpr double nullRate = 0.25;
+	constexpr double repeatRate = 0.6;
+
+	struct Layout {
+		std::vector<const Line*> ptrs;
+		std::size_t nulls = 0;
+		std::size_t repeats = 0;
+	};
+
+	// Page aligned, so a dense block of `elements` lines fills exactly elements / 64 pages.
+	const Line* Pool()
+	{
+		static std::vector<Line> pool(elements * spacing + spacing);
+		const auto addr = reinterpret_cast<std::uintptr_t>(pool.data());
+		return pool.data() + (4096 - addr % 4096) % 4096 / sizeof(Line);
+	}
+
+	Layout Sequential()
+	{
+		Layout result;
+		for (std::size_t i = 0; i < elements; ++i)
+			result.ptrs.push_back(Pool() + i);
+		return result;
+	}
+
+	Layout WithNulls(std::mt19937& gen)
+	{
+		Layout result = Sequential();
+		std::bernoulli_distribution isNull(nullRate);
+		for (auto& ptr : result.ptrs) {
+			if (isNull(gen)) {
+				ptr = nullptr;
+				++result.nulls;
+			}
+		}
+		return result;
+	}
+
+	// Sequential, but some pointers are stored twice in a row; never three times, so a sampled
+	// pair is the only place where a sample can see a repeat.
+	Layout WithRepeats(std::mt19937& gen)
+	{
+		Layout result;
+		std::bernoulli_distribution repeat(repeatRate);
+		for (std::size_t i = 0; result.ptrs.size() < elements; ++i) {
+			result.ptrs.push_back(Pool() + i);
+			if (result.ptrs.size() < elements && repeat(gen)) {
+				result.ptrs.push_back(Pool() + i);
+				++result.repeats;
+			}
+		}
+		return result;
+	}
+
+	Layout Shuffled(std::mt19937& gen, std::size_t stride)
+	{
+		Layout result;
+		for (std::size_t i = 0; i < elements; ++i)
+			result.ptrs.push_back(Pool() + i * stride);
+		std::shuffle(std::begin(result.ptrs), std::end(result.ptrs), gen);
+		return result;
+	}
+
+	bool Near(double value, double expected) { return std::fabs(value - expected) < 0.06; }
+
+	// The sampled analyses inspect pairs at every (elements / samples)th position.
+	range_of_ptrs::layout_report Analyze(const Layout& layout, std::size_t samples)
+	{
+		range_of_ptrs::layout_options options;
+		options.max_samples = samples;
+		const range_of_ptrs::layout_report report = range_of_ptrs::AnalyzeLayout(layout.ptrs, options);
+
+		LAYOUT_CHECK(report.elements == elements);
+		if (samples != 0) {
+			const std::size_t step = elements / samples;
+			LAYOUT_CHECK(report.examined == ((elements - 1) / step + 1) * 2);
+		}
+		else {
+			LAYOUT_CHECK(report.examined == elements);
+			LAYOUT_CHECK(report.nulls == layout.nulls);
+			LAYOUT_CHECK(report.duplicates == layout.repeats);
+		}
+		return report;
+	}
+
+	void CheckLayouts(std::mt19937& gen)
+	{
+		using range_of_ptrs::layout_recommendation;
+
+		for (bool sampled : { false, true }) {
+			const std::size_t samples = sampled ? 1000 : 0;
+			{
+				const auto report = Analyze(Sequential(), samples);
+				LAYOUT_CHECK(report.recommendation == layout_recommendation::none);
+				LAYOUT_CHECK(report.null_fraction() == 0.0 && report.duplicate_fraction() == 0.0);
+				LAYOUT_CHECK(report.sequential_fraction() == 1.0);
+				LAYOUT_CHECK(report.page_spread() <= 1.0 || sampled);
+			}
+			{
+				const Layout layout = WithNulls(gen);
+				const auto report = Analyze(layout, samples);
+				LAYOUT_CHECK(report.recommendation == layout_recommendation::remove_nulls);
+				LAYOUT_CHECK(Near(report.null_fraction(), nullRate));
+				LAYOUT_CHECK(report.duplicate_fraction() == 0.0);
+			}
+			{
+				// Repeats are equal pairs, all other pairs are sequential. A sample sees the
+				// repeats at the second position of its pairs only: half of them.
+				const Layout layout = WithRepeats(gen);
+				const double repeated = double(layout.repeats) / double(elements);
+				const auto report = Analyze(layout, samples);
+				LAYOUT_CHECK(report.recommendation == layout_recommendation::deduplicate);
+				LAYOUT_CHECK(Near(report.duplicate_fraction(), sampled ? repeated / 2 : repeated));
+				LAYOUT_CHECK(report.null_fraction() == 0.0);
+				LAYOUT_CHECK(Near(report.sequential_fraction(), 1.0 - (sampled ? 2 * report.duplicate_fraction() : repeated)));
+				LAYOUT_CHECK(sampled || report.sequential_pairs == report.pairs - layout.repeats);
+			}
+			{
+				// Dense but out of order: every page of the block is used.
+				const auto report = Analyze(Shuffled(gen, 1), samples);
+				LAYOUT_CHECK(report.recommendation == layout_recommendation::sort_by_address);
+				LAYOUT_CHECK(report.sequential_fraction() < 0.1);
+				LAYOUT_CHECK(report.distinct_pages == elements / spacing);
+				LAYOUT_CHECK(report.page_spread() <= (sampled ? 2.0 : 1.0));
+			}
+			{
+				// One pointee per page.
+				const auto report = Analyze(Shuffled(gen, spacing), samples);
+				LAYOUT_CHECK(report.recommendation == layout_recommendation::compact);
+				LAYOUT_CHECK(report.sequential_fraction() < 0.1);
+				LAYOUT_CHECK(report.distinct_pages == report.examined);
+				LAYOUT_CHECK(report.page_spread() > 4.0);
+			}
+		}
+
+		// A sample of fewer pointees than the range has pages: each one lands on its own page
+		// whether the range is scattered or not, so the spread has to be judged against the
+		// pages the sample itself would fill.
+		{
+			const auto report = Analyze(Shuffled(gen, spacing), 16);
+			LAYOUT_CHECK(report.distinct_pages == report.examined && report.ideal_pages == 1);
+			LAYOUT_CHECK(report.recommendation == layout_recommendation::compact);
+		}
+	}
+}
+
+
+int main(int argc, char* argv[])
+{
+	const unsigned seed = argc > 1 ? static_cast<unsigned>(std::atol(argv[1])) : 1;
+
+	std::mt19937 gen(seed);
+	for (int i = 0; i < 20; ++i)
+		layout::CheckLayouts(gen);
+
+	std::printf("layout checks passed (seed %u)\n", seed);
+	return 0;
+}
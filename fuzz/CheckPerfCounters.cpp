@@ -0,0 +1,151 @@
+// Checks of the per-algorithm counters (PerfCounters.hpp).
+//
+// A few algorithms run on ranges of known sizes, from the main thread and from a second one; the
+// registry must then hold exactly one record per (algorithm, size bucket) with the expected call
+// and element counts. Hardware counters are only checked when perf_event_open works, so the test
+// also passes in containers where the kernel refuses it and only call counts are collected.
+//
+// The counters are compiled in here whatever RANGE_OF_PTRS_PERF_COUNTERS says for the build.
+
+#ifndef RANGE_OF_PTRS_PERF_COUNTERS
+#define RANGE_OF_PTRS_PERF_COUNTERS
+#endif
+
+#include "RangeOfPointers.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+#define PERF_CHECK(cond)                                                                   \
+	do {                                                                                   \
+		if (!(cond)) {                                                                     \
+			std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+			std::abort();                                                                  \
+		}                                                                                  \
+	} while (false)
+
+
+namespace perftest
+{
+	struct Value {
+		int key;
+
+		bool operator==(const Value& other) const noexcept { return key == other.key; }
+	};
+
+	std::vector<Value*> MakeRange(std::size_t size)
+	{
+		std::vector<Value*> result;
+		for (std::size_t i = 0; i < size; ++i)
+			result.push_back(RANGE_OF_PTRS_TRACK(new Value{ static_cast<int>(i / 2) }));
+		return result;
+	}
+
+	void Free(const std::vector<Value*>& range)
+	{
+		for (Value* ptr : range)
+			RANGE_OF_PTRS_DELETE(ptr, "Free");
+	}
+
+	const range_of_ptrs::perf::record* Find(const std::vector<range_of_ptrs::perf::record>& records, const std::string& algorithm, std::size_t bucket)
+	{
+		for (const auto& rec : records) {
+			if (rec.algorithm == algorithm && rec.size_bucket == bucket)
+				return &rec;
+		}
+		return nullptr;
+	}
+
+	void CheckSizeBuckets()
+	{
+		using range_of_ptrs::perf::detail::size_bucket;
+		PERF_CHECK(size_bucket(0) == 0);
+		PERF_CHECK(size_bucket(1) == 1);
+		PERF_CHECK(size_bucket(2) == 2 && size_bucket(3) == 2);
+		PERF_CHECK(size_bucket(1023) == 512 && size_bucket(1024) == 1024 && size_bucket(1025) == 1024);
+	}
+
+	// Copy of 100 elements (bucket 64) on this thread and on another, Copy of 1000 (bucket 512),
+	// CopyIf of 100 and Unique of 300 (bucket 256), each counted on its own.
+	void CheckRecords()
+	{
+		range_of_ptrs::perf::reset();
+
+		const std::vector<Value*> small = MakeRange(100);
+		const std::vector<Value*> large = MakeRange(1000);
+		const std::vector<Value*> smallDest = MakeRange(100);
+		const std::vector<Value*> largeDest = MakeRange(1000);
+
+		range_of_ptrs::Copy(std::begin(small), std::end(small), std::begin(smallDest));
+		std::thread other([&] { range_of_ptrs::Copy(std::begin(small), std::end(small), std::begin(smallDest)); });
+		other.join();
+		range_of_ptrs::Copy(std::begin(large), std::end(large), std::begin(largeDest));
+
+		const auto odd = [](const Value& value) { return value.key % 2 != 0; };
+		const auto copied = range_of_ptrs::CopyIf(std::begin(small), std::end(small), std::begin(smallDest), odd);
+		PERF_CHECK(copied == std::begin(smallDest) + 50);
+
+		std::vector<Value*> duplicates = MakeRange(300);
+		duplicates.erase(range_of_ptrs::Unique(std::begin(duplicates), std::end(duplicates), std::equal_to<>()), std::end(duplicates));
+		PERF_CHECK(duplicates.size() == 150);
+
+		const auto records = range_of_ptrs::perf::snapshot();
+		PERF_CHECK(records.size() == 4);
+
+		const auto copySmall = Find(records, "Copy", 64);
+		const auto copyLarge = Find(records, "Copy", 512);
+		const auto copyIf = Find(records, "CopyIf", 64);
+		const auto unique = Find(records, "Unique", 256);
+		PERF_CHECK(copySmall != nullptr && copySmall->calls == 2 && copySmall->elements == 200);
+		PERF_CHECK(copyLarge != nullptr && copyLarge->calls == 1 && copyLarge->elements == 1000);
+		PERF_CHECK(copyIf != nullptr && copyIf->calls == 1 && copyIf->elements == 100);
+		PERF_CHECK(unique != nullptr && unique->calls == 1 && unique->elements == 300);
+
+		// Hardware counts when the kernel grants them, nothing otherwise.
+		for (const auto& rec : records) {
+			if (range_of_ptrs::perf::available()) {
+				PERF_CHECK(rec.totals[range_of_ptrs::perf::cycles] != 0);
+			}
+			else {
+				for (std::uint64_t total : rec.totals)
+					PERF_CHECK(total == 0);
+			}
+		}
+
+		// A header and one line per record.
+		std::ostringstream os;
+		range_of_ptrs::perf::report(os);
+		const std::string text = os.str();
+		PERF_CHECK(static_cast<std::size_t>(std::count(std::begin(text), std::end(text), '\n')) == 1 + records.size());
+		PERF_CHECK(text.find("\nCopy 64 2 ") != std::string::npos);
+
+		range_of_ptrs::perf::reset();
+		PERF_CHECK(range_of_ptrs::perf::snapshot().empty());
+
+		Free(small);
+		Free(large);
+		Free(smallDest);
+		Free(largeDest);
+		Free(duplicates);
+	}
+}
+
+
+int main()
+{
+	perftest::CheckSizeBuckets();
+	perftest::CheckRecords();
+
+	std::printf("perf counter checks passed (hardware counters %s)\n", range_of_ptrs::perf::available() ? "available" : "unavailable");
+	return 0;
+}
@@ -0,0 +1,1043 @@
+// Differential fuzzing of the algorithms in RangeOfPointers.hpp.
+//
+// Every input is decoded into a pointer range of `fuzz::Counted` objects (small keys so that
+// duplicates are frequent, optionally with aliased pointers for the algorithms that do not
+// delete), the algorithm under test runs on the pointers and the std:: equivalent runs on the
+// plain keys. Results must match and no Counted object may leak or be deleted twice.
+//
+// Built with -fsanitize=fuzzer (Clang) this file is a libFuzzer target. Otherwise it has a
+// main() that feeds random inputs from a fixed seed: `range_of_ptrs_fuzz [iterations] [seed]`.
+
+#include "RangeOfPointers.hpp"
+#include "AbbreviatedKeys.hpp"
+#include "Aliasing.hpp"
+#include "ArgSort.hpp"
+#include "Branchless.hpp"
+#include "NullPointers.hpp"
+#include "Parallel.hpp"
+#include "Serialization.hpp"
+#include "ShardedPtrVector.hpp"
+#include "SlotMap.hpp"
+#include "Selection.hpp"
+#include "TaggedPointers.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <list>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+
+#define FUZZ_CHECK(cond)                                                                   \
+	do {                                                                                   \
+		if (!(cond)) {                                                                     \
+			std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+			std::abort();                                                                  \
+		}                                                                                  \
+	} while (false)
+
+
+namespace fuzz
+{
+	struct Counted {
+		explicit Counted(int key = 0) : key_{ key } { ++living_; }
+		Counted(const Counted& other) : key_{ other.key_ } { ++living_; }
+		Counted& operator=(const Counted& other) { key_ = other.key_; return *this; }
+		virtual ~Counted() { --living_; }
+
+		virtual Counted* Clone() const { return new Counted(*this); }
+
+		inline bool operator==(const Counted& other) const noexcept { return key_ == other.key_; }
+		inline bool operator< (const Counted& other) const noexcept { return key_ < other.key_; }
+
+		inline int getKey() const noexcept { return key_; }
+		static int livingCount() noexcept { return living_; }
+
+	private:
+		static inline std::atomic<int> living_{ 0 };
+		int key_ = 0;
+	};
+
+	using PtrVector = std::vector<Counted*>;
+
+	struct ByteSource {
+		ByteSource(const std::uint8_t* data, std::size_t size) : data_{ data }, size_{ size } {}
+
+		std::uint8_t next() { return pos_ < size_ ? data_[pos_++] : 0; }
+		bool empty() const noexcept { return pos_ >= size_; }
+
+	private:
+		const std::uint8_t* data_;
+		std::size_t size_;
+		std::size_t pos_ = 0;
+	};
+
+	// Keys in [0, 8) so that Unique and Remove find plenty of equal elements.
+	// With `aliasing` some slots repeat a pointer that already occurs earlier in the range.
+	PtrVector MakeRange(ByteSource& src, bool aliasing)
+	{
+		const std::size_t length = src.next() % 48;
+		PtrVector result;
+		result.reserve(length);
+		for (std::size_t i = 0; i < length; ++i) {
+			const std::uint8_t byte = src.next();
+			if (aliasing && !result.empty() && (byte & 0x80) != 0)
+				result.push_back(result[byte % result.size()]);
+			else
+				result.push_back(RANGE_OF_PTRS_TRACK(new Counted(byte % 8)));
+		}
+		return result;
+	}
+
+	PtrVector MakeDefaultRange(std::size_t length)
+	{
+		PtrVector result;
+		for (std::size_t i = 0; i < length; ++i)
+			result.push_back(RANGE_OF_PTRS_TRACK(new Counted(-1)));
+		return result;
+	}
+
+	std::vector<int> Keys(const PtrVector& range)
+	{
+		std::vector<int> result;
+		for (auto p : range)
+			result.push_back(p->getKey());
+		return result;
+	}
+
+	template<typename Iter>
+	std::vector<int> Keys(Iter first, Iter last)
+	{
+		std::vector<int> result;
+		for (; first != last; ++first)
+			result.push_back((*first)->getKey());
+		return result;
+	}
+
+	// Deletes every distinct non-null pointer of the range once.
+	void FreeDistinct(const PtrVector& range)
+	{
+		std::unordered_set<Counted*> seen;
+		for (auto p : range) {
+			if (p != nullptr && seen.insert(p).second)
+				RANGE_OF_PTRS_DELETE(p, "FreeDistinct");
+		}
+	}
+
+	const auto keyPred = [](int key) { return key % 3 != 0; };
+	const auto pred = [](const Counted& obj) { return keyPred(obj.getKey()); };
+
+
+	void CheckCopy(ByteSource& src)
+	{
+		PtrVector from = MakeRange(src, true);
+		PtrVector to = MakeDefaultRange(from.size());
+		const std::vector<int> expected = Keys(from);
+
+		// The list sources take the paths for iterators that are not random access.
+		const std::list<Counted*> fromList(from.begin(), from.end());
+		switch (src.next() % 5) {
+		case 0:
+			FUZZ_CHECK(range_of_ptrs::Copy(from.begin(), from.end(), to.begin()) == to.end());
+			break;
+		case 1:
+			FUZZ_CHECK(range_of_ptrs::CopyN(from.begin(), from.size(), to.begin()) == to.end());
+			break;
+		case 2:
+			FUZZ_CHECK(range_of_ptrs::CopyN(fromList.begin(), from.size(), to.begin()) == to.end());
+			break;
+		case 3:
+			FUZZ_CHECK(range_of_ptrs::CopyBackward(fromList.begin(), fromList.end(), to.end()) == to.begin());
+			break;
+		default:
+			FUZZ_CHECK(range_of_ptrs::CopyBackward(from.begin(), from.end(), to.end()) == to.begin());
+			break;
+		}
+		FUZZ_CHECK(Keys(to) == expected);
+
+		FreeDistinct(from);
+		FreeDistinct(to);
+	}
+
+	void CheckCopyIf(ByteSource& src)
+	{
+		PtrVector from = MakeRange(src, true);
+		PtrVector to = MakeDefaultRange(from.size());
+		const std::vector<int> keys = Keys(from);
+
+		std::vector<int> expected;
+		std::copy_if(keys.begin(), keys.end(), std::back_inserter(expected), keyPred);
+
+		auto last = src.next() % 2 == 0
+			? range_of_ptrs::CopyIf(from.begin(), from.end(), to.begin(), pred)
+			: range_of_ptrs::CopyIf(range_of_ptrs::branchless, from.begin(), from.end(), to.begin(), pred);
+		FUZZ_CHECK(static_cast<std::size_t>(last - to.begin()) == expected.size());
+		FUZZ_CHECK(Keys(to.begin(), last) == expected);
+
+		FreeDistinct(from);
+		FreeDistinct(to);
+	}
+
+	// Output iterator forms: only the selected elements are allocated, the destination is never read.
+	void CheckCopyIfToNew(ByteSource& src)
+	{
+		PtrVector from = MakeRange(src, true);
+		const std::vector<int> keys = Keys(from);
+
+		std::vector<int> expected;
+		std::copy_if(keys.begin(), keys.end(), std::back_inserter(expected), keyPred);
+
+		PtrVector to;
+		switch (src.next() % 4) {
+		case 0:
+			range_of_ptrs::CopyIfToNew(from.begin(), from.end(), std::back_inserter(to), pred);
+			break;
+		case 1:
+			range_of_ptrs::CloneIf(from.begin(), from.end(), std::back_inserter(to), pred);
+			break;
+		case 2:
+			to = range_of_ptrs::CopyIfToContainer<PtrVector>(from.begin(), from.end(), pred);
+			FUZZ_CHECK(to.capacity() == expected.size());
+			break;
+		default:
+			to = range_of_ptrs::CloneIfToContainer<PtrVector>(from.begin(), from.end(), pred);
+			FUZZ_CHECK(to.capacity() == expected.size());
+			break;
+		}
+		FUZZ_CHECK(Keys(to) == expected);
+		for (auto p : to)
+			FUZZ_CHECK(std::find(from.begin(), from.end(), p) == from.end());
+
+		FreeDistinct(from);
+		FreeDistinct(to);
+	}
+
+	// Destinations without live objects: raw storage for the copies, uninitialized pointers for the clones.
+	void CheckUninitialized(ByteSource& src)
+	{
+		PtrVector from = MakeRange(src, true);
+		const std::vector<int> expected = Keys(from);
+		const int living = Counted::livingCount();
+
+		if (src.next() % 2 == 0) {
+			std::allocator<Counted> alloc;
+			Counted* storage = alloc.allocate(from.size());
+			PtrVector slots;
+			for (std::size_t i = 0; i < from.size(); ++i)
+				slots.push_back(storage + i);
+
+			FUZZ_CHECK(range_of_ptrs::UninitializedCopyToPtrs(from.begin(), from.end(), slots.begin()) == slots.end());
+			FUZZ_CHECK(Keys(slots) == expected);
+			FUZZ_CHECK(Counted::livingCount() == living + static_cast<int>(from.size()));
+
+			std::for_each(slots.begin(), slots.end(), [](Counted* p) { p->~Counted(); });
+			alloc.deallocate(storage, from.size());
+		}
+		else {
+			PtrVector to(from.size());
+			FUZZ_CHECK(range_of_ptrs::CloneToNew(from.begin(), from.end(), to.begin()) == to.end());
+			FUZZ_CHECK(Keys(to) == expected);
+			FreeDistinct(to);
+		}
+		FUZZ_CHECK(Counted::livingCount() == living);
+
+		FreeDistinct(from);
+	}
+
+	void CheckReplaceCopy(ByteSource& src)
+	{
+		PtrVector from = MakeRange(src, true);
+		PtrVector to = MakeDefaultRange(from.size());
+		const PtrVector slots = to;
+		std::vector<int> expected = Keys(from);
+
+		if (src.next() % 2 == 0) {
+			range_of_ptrs::ReplaceCopy(from.begin(), from.end(), to.begin());
+		}
+		else {
+			std::replace_if(expected.begin(), expected.end(), [](int key) { return !keyPred(key); }, -1);
+			range_of_ptrs::ReplaceCopyIf(from.begin(), from.end(), to.begin(), pred);
+		}
+		FUZZ_CHECK(to == slots);
+		FUZZ_CHECK(Keys(to) == expected);
+
+		FreeDistinct(from);
+		FreeDistinct(to);
+	}
+
+	void CheckClone(ByteSource& src)
+	{
+		PtrVector from = MakeRange(src, true);
+		const std::vector<int> keys = Keys(from);
+
+		// Clone and CloneIf overwrite the destination slots without deleting them.
+		PtrVector to = MakeDefaultRange(from.size());
+		const PtrVector overwritten = to;
+
+		std::vector<int> expected;
+		PtrVector::iterator last;
+		switch (src.next() % 5) {
+		case 0:
+			expected = keys;
+			last = range_of_ptrs::Clone(from.begin(), from.end(), to.begin());
+			FreeDistinct(overwritten);
+			break;
+		case 1:
+			std::copy_if(keys.begin(), keys.end(), std::back_inserter(expected), keyPred);
+			last = range_of_ptrs::CloneIf(from.begin(), from.end(), to.begin(), pred);
+			FreeDistinct(PtrVector(overwritten.begin(), overwritten.begin() + (last - to.begin())));
+			break;
+		case 2:
+			std::copy_if(keys.begin(), keys.end(), std::back_inserter(expected), keyPred);
+			last = range_of_ptrs::CloneIf(range_of_ptrs::branchless, from.begin(), from.end(), to.begin(), pred);
+			FreeDistinct(PtrVector(overwritten.begin(), overwritten.begin() + (last - to.begin())));
+			break;
+		case 3:
+			expected = keys;
+			last = range_of_ptrs::ReplaceClone(from.begin(), from.end(), to.begin());
+			break;
+		default:
+			std::copy_if(keys.begin(), keys.end(), std::back_inserter(expected), keyPred);
+			last = range_of_ptrs::ReplaceCloneIf(from.begin(), from.end(), to.begin(), pred);
+			break;
+		}
+
+		FUZZ_CHECK(static_cast<std::size_t>(last - to.begin()) == expected.size());
+		FUZZ_CHECK(Keys(to.begin(), last) == expected);
+		for (auto it = to.begin(); it != last; ++it)
+			FUZZ_CHECK(std::find(from.begin(), from.end(), *it) == from.end());
+
+		FreeDistinct(from);
+		FreeDistinct(to);
+	}
+
+	void CheckRemove(ByteSource& src)
+	{
+		PtrVector range = MakeRange(src, false);
+		const std::vector<int> keys = Keys(range);
+		const int value = src.next() % 8;
+		const int livingBefore = Counted::livingCount();
+
+		std::vector<int> expected = keys;
+		PtrVector::iterator last;
+		if (src.next() % 2 == 0) {
+			expected.erase(std::remove(expected.begin(), expected.end(), value), expected.end());
+			last = range_of_ptrs::Remove(range.begin(), range.end(), Counted(value));
+		}
+		else {
+			expected.erase(std::remove_if(expected.begin(), expected.end(), keyPred), expected.end());
+			last = range_of_ptrs::RemoveIf(range.begin(), range.end(), 0, pred);
+		}
+
+		FUZZ_CHECK(Keys(range.begin(), last) == expected);
+		FUZZ_CHECK(livingBefore - Counted::livingCount() == static_cast<int>(keys.size() - expected.size()));
+
+		range.erase(last, range.end());
+		FreeDistinct(range);
+	}
+
+	void CheckUnique(ByteSource& src)
+	{
+		PtrVector range = MakeRange(src, false);
+		if (src.next() % 2 == 0)
+			std::sort(range.begin(), range.end(), range_of_ptrs::BinaryFunctorDerefPtrsAdapter<std::less<>>());
+		const std::vector<int> keys = Keys(range);
+		const int livingBefore = Counted::livingCount();
+
+		std::vector<int> expected = keys;
+		PtrVector::iterator last;
+		if (src.next() % 2 == 0) {
+			expected.erase(std::unique(expected.begin(), expected.end()), expected.end());
+			last = range_of_ptrs::Unique(range.begin(), range.end());
+		}
+		else {
+			const auto sameParity = [](int lhs, int rhs) { return lhs % 2 == rhs % 2; };
+			expected.erase(std::unique(expected.begin(), expected.end(), sameParity), expected.end());
+			last = range_of_ptrs::Unique(range.begin(), range.end(), [&](const Counted& lhs, const Counted& rhs) {
+				return sameParity(lhs.getKey(), rhs.getKey());
+			});
+		}
+
+		FUZZ_CHECK(Keys(range.begin(), last) == expected);
+		FUZZ_CHECK(livingBefore - Counted::livingCount() == static_cast<int>(keys.size() - expected.size()));
+
+		range.erase(last, range.end());
+		FreeDistinct(range);
+	}
+
+	// A coarse abbreviation, so that ties fall back to the full comparison.
+	void CheckAbbreviated(ByteSource& src)
+	{
+		PtrVector range = MakeRange(src, false);
+		std::vector<int> expected = Keys(range);
+		std::sort(expected.begin(), expected.end());
+		const auto abbreviate = [](const Counted& obj) { return range_of_ptrs::AbbreviateInteger(obj.getKey() / 3); };
+
+		if (src.next() % 2 == 0) {
+			const int livingBefore = Counted::livingCount();
+			const auto last = range_of_ptrs::SortUniqueAbbreviated(range.begin(), range.end(), abbreviate);
+			const std::size_t size = expected.size();
+			expected.erase(std::unique(expected.begin(), expected.end()), expected.end());
+
+			FUZZ_CHECK(Keys(range.begin(), last) == expected);
+			FUZZ_CHECK(std::all_of(last, range.end(), [](Counted* p) { return p == nullptr; }));
+			FUZZ_CHECK(livingBefore - Counted::livingCount() == static_cast<int>(size - expected.size()));
+		}
+		else {
+			range_of_ptrs::SortAbbreviated(range.begin(), range.end(), abbreviate);
+			FUZZ_CHECK(Keys(range) == expected);
+
+			const auto keys = range_of_ptrs::AbbreviateRange(range.begin(), range.end(), abbreviate);
+			for (int key = -1; key <= 8; ++key) {
+				const Counted value{ key };
+				const auto lower = range_of_ptrs::LowerBoundAbbreviated(keys.begin(), keys.end(), value, abbreviate);
+				const auto upper = range_of_ptrs::UpperBoundAbbreviated(keys.begin(), keys.end(), value, abbreviate);
+				FUZZ_CHECK(lower - keys.begin() == std::lower_bound(expected.begin(), expected.end(), key) - expected.begin());
+				FUZZ_CHECK(upper - keys.begin() == std::upper_bound(expected.begin(), expected.end(), key) - expected.begin());
+				FUZZ_CHECK(range_of_ptrs::BinarySearchAbbreviated(keys.begin(), keys.end(), value, abbreviate)
+					== std::binary_search(expected.begin(), expected.end(), key));
+			}
+		}
+
+		FreeDistinct(range);
+	}
+
+	// Ordering tags coarser than the keys (key / 3) and hash fingerprints for the equality checks.
+	void CheckTagged(ByteSource& src)
+	{
+		PtrVector range = MakeRange(src, false);
+		std::vector<int> expected = Keys(range);
+		const auto orderTag = [](const Counted& obj) { return static_cast<std::uint16_t>(obj.getKey() / 3); };
+		const auto fingerprint = [](const Counted& obj) { return range_of_ptrs::FingerprintTag(std::hash<int>()(obj.getKey())); };
+
+		switch (src.next() % 3) {
+		case 0: {
+			auto tagged = range_of_ptrs::TagRange(range.begin(), range.end(), orderTag);
+			range_of_ptrs::SortTagged(tagged.begin(), tagged.end());
+			tagged.erase(range_of_ptrs::UniqueTagged(tagged.begin(), tagged.end()), tagged.end());
+			range_of_ptrs::raii_ptrs_range_wrapper<range_of_ptrs::untagged_iterator<decltype(tagged)::iterator>> owner{
+				range_of_ptrs::MakeUntagged(tagged.begin()), range_of_ptrs::MakeUntagged(tagged.end()) };
+
+			std::sort(expected.begin(), expected.end());
+			expected.erase(std::unique(expected.begin(), expected.end()), expected.end());
+			FUZZ_CHECK(Keys(range_of_ptrs::MakeUntagged(tagged.begin()), range_of_ptrs::MakeUntagged(tagged.end())) == expected);
+
+			for (int key = -1; key <= 8; ++key) {
+				const Counted value{ key };
+				const auto tag = orderTag(value);
+				const auto lower = range_of_ptrs::LowerBoundTagged(tagged.begin(), tagged.end(), value, tag);
+				const auto upper = range_of_ptrs::UpperBoundTagged(tagged.begin(), tagged.end(), value, tag);
+				FUZZ_CHECK(lower - tagged.begin() == std::lower_bound(expected.begin(), expected.end(), key) - expected.begin());
+				FUZZ_CHECK(upper - tagged.begin() == std::upper_bound(expected.begin(), expected.end(), key) - expected.begin());
+				FUZZ_CHECK(range_of_ptrs::BinarySearchTagged(tagged.begin(), tagged.end(), value, tag)
+					== std::binary_search(expected.begin(), expected.end(), key));
+			}
+			return;
+		}
+		case 1: {
+			auto tagged = range_of_ptrs::TagRange(range.begin(), range.end(), fingerprint);
+			const Counted value{ src.next() % 8 };
+			tagged.erase(range_of_ptrs::RemoveTagged(tagged.begin(), tagged.end(), value, fingerprint(value)), tagged.end());
+			range_of_ptrs::raii_ptrs_range_wrapper<range_of_ptrs::untagged_iterator<decltype(tagged)::iterator>> owner{
+				range_of_ptrs::MakeUntagged(tagged.begin()), range_of_ptrs::MakeUntagged(tagged.end()) };
+
+			expected.erase(std::remove(expected.begin(), expected.end(), value.getKey()), expected.end());
+			FUZZ_CHECK(Keys(range_of_ptrs::MakeUntagged(tagged.begin()), range_of_ptrs::MakeUntagged(tagged.end())) == expected);
+			return;
+		}
+		default: {
+			// The read-only algorithms through untagged_iterator.
+			const auto tagged = range_of_ptrs::TagRange(range.begin(), range.end(), fingerprint);
+			const PtrVector copy = range_of_ptrs::DeepCopyOfRange<PtrVector>(range_of_ptrs::MakeUntagged(tagged.begin()), range_of_ptrs::MakeUntagged(tagged.end()));
+			range_of_ptrs::raii_ptrs_container_wrapper<PtrVector> owner{ copy };
+			FUZZ_CHECK(Keys(copy) == expected);
+			FreeDistinct(range);
+			return;
+		}
+		}
+	}
+
+	// Selections combined and refined, then materialized, against filtering the keys twice.
+	void CheckSelect(ByteSource& src)
+	{
+		PtrVector from = MakeRange(src, true);
+		const std::vector<int> keys = Keys(from);
+		const auto low = [](const Counted& obj) { return obj.getKey() < 4; };
+
+		const range_of_ptrs::selection evens = range_of_ptrs::Select(from.begin(), from.end(), pred);
+		const bool combineWithOr = src.next() % 2 == 0;
+		const std::list<Counted*> fromList(from.begin(), from.end());
+		range_of_ptrs::selection sel;
+		if (combineWithOr)
+			sel = evens | range_of_ptrs::Select(fromList.begin(), fromList.end(), low);
+		else
+			sel = src.next() % 2 == 0 ? evens & range_of_ptrs::Select(from.begin(), from.end(), low) : range_of_ptrs::Refine(evens, from.begin(), low);
+
+		std::vector<int> expected;
+		std::vector<std::uint32_t> expectedIndices;
+		for (std::size_t i = 0; i < keys.size(); ++i) {
+			const bool selected = combineWithOr ? keyPred(keys[i]) || keys[i] < 4 : keyPred(keys[i]) && keys[i] < 4;
+			FUZZ_CHECK(sel.test(i) == selected);
+			if (selected) {
+				expected.push_back(keys[i]);
+				expectedIndices.push_back(static_cast<std::uint32_t>(i));
+			}
+		}
+		FUZZ_CHECK(sel.count() == expected.size());
+		FUZZ_CHECK(sel.indices() == expectedIndices);
+
+		const int living = Counted::livingCount();
+		switch (src.next() % 3) {
+		case 0: {
+			PtrVector to = MakeDefaultRange(expected.size());
+			FUZZ_CHECK(range_of_ptrs::MaterializeCopy(from.begin(), sel, to.begin()) == to.end());
+			FUZZ_CHECK(Keys(to) == expected);
+			FreeDistinct(to);
+			break;
+		}
+		case 1: {
+			PtrVector to;
+			range_of_ptrs::MaterializeClone(from.begin(), sel, std::back_inserter(to));
+			FUZZ_CHECK(Keys(to) == expected);
+			FreeDistinct(to);
+			break;
+		}
+		default: {
+			const PtrVector to = range_of_ptrs::MaterializeDeepCopy<PtrVector>(from.begin(), sel);
+			FUZZ_CHECK(to.capacity() == expected.size());
+			FUZZ_CHECK(Keys(to) == expected);
+			FreeDistinct(to);
+			break;
+		}
+		}
+		FUZZ_CHECK(Counted::livingCount() == living);
+
+		FreeDistinct(from);
+	}
+
+	// ArgSortByKey against std::stable_sort of the positions by the same keys. Every slice count
+	// is forced on these short ranges with parallel_threshold 0.
+	template<typename Projection>
+	void CheckArgSortBy(const PtrVector& from, Projection proj, const range_of_ptrs::argsort_options& options)
+	{
+		std::vector<std::uint32_t> expected(from.size());
+		std::iota(expected.begin(), expected.end(), std::uint32_t{ 0 });
+		std::stable_sort(expected.begin(), expected.end(), [&](std::uint32_t lhs, std::uint32_t rhs) {
+			return proj(*from[lhs]) < proj(*from[rhs]);
+		});
+		FUZZ_CHECK(range_of_ptrs::ArgSortByKey(from.begin(), from.end(), proj, options) == expected);
+	}
+
+	void CheckArgSort(ByteSource& src)
+	{
+		const PtrVector from = MakeRange(src, true);
+		const std::vector<int> keys = Keys(from);
+
+		range_of_ptrs::argsort_options options;
+		if (src.next() % 2 == 0) {
+			options.threads = 1 + src.next() % 4;
+			options.parallel_threshold = 0;
+		}
+
+		switch (src.next() % 4) {
+		case 0:
+			CheckArgSortBy(from, [](const Counted& obj) { return (obj.getKey() - 4) * 1000003; }, options);
+			break;
+		case 1:
+			CheckArgSortBy(from, [](const Counted& obj) { return static_cast<unsigned short>(obj.getKey() * 9000); }, options);
+			break;
+		case 2:
+			CheckArgSortBy(from, [](const Counted& obj) { return (obj.getKey() % 3 - 1) * (1LL << 40); }, options);
+			break;
+		default:
+			CheckArgSortBy(from, [](const Counted& obj) { return std::to_string(obj.getKey() * 7); }, options);
+			break;
+		}
+		FUZZ_CHECK(Keys(from) == keys);
+
+		FreeDistinct(from);
+	}
+
+	void CheckDeepCopy(ByteSource& src)
+	{
+		PtrVector from = MakeRange(src, true);
+		PtrVector to = src.next() % 2 == 0
+			? range_of_ptrs::DeepCopy(from)
+			: range_of_ptrs::DeepCopy<std::list<Counted*>, PtrVector>(std::list<Counted*>(from.begin(), from.end()));
+
+		FUZZ_CHECK(Keys(to) == Keys(from));
+		for (auto p : to)
+			FUZZ_CHECK(std::find(from.begin(), from.end(), p) == from.end());
+
+		FreeDistinct(from);
+		FreeDistinct(to);
+	}
+
+	// Aliased sources: one copy per distinct pointee, the copies alias like the source.
+	void CheckAliasedDeepCopy(ByteSource& src)
+	{
+		PtrVector from = MakeRange(src, true);
+		const int living = Counted::livingCount();
+		{
+			const PtrVector to = range_of_ptrs::DeepCopy(range_of_ptrs::preserve_aliasing, from);
+			range_of_ptrs::raii_ptrs_aliased_container_wrapper<PtrVector> owner{ to };
+
+			FUZZ_CHECK(Keys(to) == Keys(from));
+			FUZZ_CHECK(Counted::livingCount() - living == static_cast<int>(std::unordered_set<Counted*>(from.begin(), from.end()).size()));
+			for (std::size_t i = 0; i < from.size(); ++i) {
+				FUZZ_CHECK(std::find(from.begin(), from.end(), to[i]) == from.end());
+				for (std::size_t j = 0; j < i; ++j)
+					FUZZ_CHECK((from[i] == from[j]) == (to[i] == to[j]));
+			}
+		}
+		FUZZ_CHECK(Counted::livingCount() == living);
+
+		range_of_ptrs::DeleteDistinct(from.begin(), from.end());
+	}
+
+	// Null slots scattered through the range: CountNulls and CompactNulls (SIMD on vectors) against
+	// std::count / std::remove, then the may_contain_nulls policy of Remove and Unique.
+	void CheckNulls(ByteSource& src)
+	{
+		PtrVector range = MakeRange(src, false);
+		for (auto& p : range) {
+			if (src.next() % 3 == 0) {
+				RANGE_OF_PTRS_DELETE(p, "CheckNulls");
+				p = nullptr;
+			}
+		}
+		PtrVector expected = range;
+		expected.erase(std::remove(expected.begin(), expected.end(), nullptr), expected.end());
+
+		FUZZ_CHECK(range_of_ptrs::CountNulls(range.cbegin(), range.cend()) == std::count(range.begin(), range.end(), nullptr));
+
+		PtrVector::iterator last;
+		switch (src.next() % 3) {
+		case 0:
+			last = range_of_ptrs::CompactNulls(range.begin(), range.end());
+			FUZZ_CHECK(PtrVector(range.begin(), last) == expected);
+			break;
+		case 1: {
+			const int value = src.next() % 8;
+			std::vector<int> keys = Keys(expected);
+			keys.erase(std::remove(keys.begin(), keys.end(), value), keys.end());
+			last = range_of_ptrs::Remove(range_of_ptrs::may_contain_nulls, range.begin(), range.end(), Counted(value));
+			FUZZ_CHECK(Keys(range.begin(), last) == keys);
+			break;
+		}
+		default: {
+			std::vector<int> keys = Keys(expected);
+			keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+			last = range_of_ptrs::Unique(range_of_ptrs::may_contain_nulls, range.begin(), range.end());
+			FUZZ_CHECK(Keys(range.begin(), last) == keys);
+			break;
+		}
+		}
+		FUZZ_CHECK(std::count(range.begin(), last, nullptr) == 0);
+
+		range.erase(last, range.end());
+		FreeDistinct(range);
+	}
+
+	// Trivially copyable pointee for Serialize/Deserialize.
+	struct Plain {
+		std::int32_t key;
+		std::uint8_t tag;
+	};
+
+	// Serialize -> Deserialize round trip of a range with runs of adjacent and scattered pointees,
+	// then the same bytes with a corrupted header, which must be rejected with runtime_error and
+	// without allocating for objects the input does not contain.
+	void CheckSerialization(ByteSource& src)
+	{
+		const std::size_t length = src.next() % 48;
+		std::vector<Plain> storage(length);
+		std::vector<Plain*> range;
+		for (std::size_t i = 0; i < length; ++i) {
+			const std::uint8_t byte = src.next();
+			storage[i] = Plain{ byte * 1000 - 50000, static_cast<std::uint8_t>(i) };
+			range.push_back(&storage[(byte & 0x80) != 0 ? byte % length : i]);
+		}
+
+		std::stringstream stream;
+		range_of_ptrs::ostream_sink sink{ stream };
+		range_of_ptrs::Serialize(range, sink);
+		const std::string bytes = stream.str();
+		FUZZ_CHECK(bytes.size() == 64 + length * sizeof(Plain));
+
+		{
+			range_of_ptrs::ptr_arena arena;
+			range_of_ptrs::istream_source source{ stream };
+			const auto loaded = range_of_ptrs::Deserialize<std::vector<Plain*>>(source, arena);
+			FUZZ_CHECK(loaded.size() == length);
+			for (std::size_t i = 0; i < length; ++i)
+				FUZZ_CHECK(loaded[i]->key == range[i]->key && loaded[i]->tag == range[i]->tag);
+		}
+
+		range_of_ptrs::serialized_header header;
+		std::memcpy(&header, bytes.data(), sizeof(header));
+		switch (src.next() % 6) {
+		case 0: header.count = std::numeric_limits<std::size_t>::max() / sizeof(Plain) + 1 + src.next(); break;
+		case 1: header.count += 1 + src.next(); break;
+		case 2: header.data_offset = std::uint64_t{ 1 } << (7 + src.next() % 57); break;
+		case 3: header.data_offset = src.next() % sizeof(header); break;
+		case 4: header.count = std::uint64_t{ 1 } << (30 + src.next() % 10); break;      // in range, far beyond the data
+		default: header.magic[src.next() % 4] ^= 0x20; break;
+		}
+
+		std::string corrupted = bytes;
+		std::memcpy(&corrupted[0], &header, sizeof(header));
+		std::istringstream input{ corrupted };
+		range_of_ptrs::istream_source source{ input };
+		range_of_ptrs::ptr_arena arena;
+		bool rejected = false;
+		try {
+			range_of_ptrs::Deserialize<std::vector<Plain*>>(source, arena);
+		}
+		catch (const std::runtime_error&) {
+			rejected = true;
+		}
+		FUZZ_CHECK(rejected);
+	}
+
+	using Sharded = range_of_ptrs::sharded_ptr_vector<Counted>;
+
+	// sharded_ptr_vector against the same operations on the keys in shard-major order; Unique must
+	// also merge the runs that continue across shard boundaries.
+	void CheckSharded(ByteSource& src)
+	{
+		Sharded sharded{ 1 + src.next() % 4u };
+		std::vector<std::vector<int>> shardKeys(sharded.shards_count());
+		const bool roundRobin = src.next() % 2 == 0;
+		for (Counted* ptr : MakeRange(src, false)) {
+			const std::size_t shard = roundRobin ? sharded.size() % shardKeys.size() : src.next() % shardKeys.size();
+			shardKeys[shard].push_back(ptr->getKey());
+			if (roundRobin)
+				sharded.push_back(ptr);
+			else
+				sharded.push_back(shard, ptr);
+		}
+
+		const auto globalKeys = [](const std::vector<std::vector<int>>& shards) {
+			std::vector<int> result;
+			for (const auto& keys : shards)
+				result.insert(result.end(), keys.begin(), keys.end());
+			return result;
+		};
+		FUZZ_CHECK(Keys(sharded.begin(), sharded.end()) == globalKeys(shardKeys));
+
+		switch (src.next() % 6) {
+		case 0: {
+			const Counted value{ src.next() % 8 };
+			sharded.Remove(value);
+			for (auto& keys : shardKeys)
+				keys.erase(std::remove(keys.begin(), keys.end(), value.getKey()), keys.end());
+			FUZZ_CHECK(Keys(sharded.begin(), sharded.end()) == globalKeys(shardKeys));
+			break;
+		}
+		case 1: {
+			sharded.Unique();
+			std::vector<int> expected = globalKeys(shardKeys);
+			expected.erase(std::unique(expected.begin(), expected.end()), expected.end());
+			FUZZ_CHECK(Keys(sharded.begin(), sharded.end()) == expected);
+			FUZZ_CHECK(sharded.size() == expected.size());
+			break;
+		}
+		case 2: {
+			sharded.SortShards();
+			for (std::size_t i = 0; i < shardKeys.size(); ++i) {
+				std::sort(shardKeys[i].begin(), shardKeys[i].end());
+				FUZZ_CHECK(Keys(sharded.shard(i)) == shardKeys[i]);
+			}
+			const PtrVector merged = sharded.merged();
+			std::vector<int> expected = globalKeys(shardKeys);
+			std::sort(expected.begin(), expected.end());
+			FUZZ_CHECK(Keys(merged) == expected);
+			FUZZ_CHECK(std::is_permutation(merged.begin(), merged.end(), sharded.begin(), sharded.end()));
+			break;
+		}
+		case 3: {
+			const Sharded copy = sharded.CopyIf(pred);
+			FUZZ_CHECK(copy.shards_count() == sharded.shards_count());
+			for (std::size_t i = 0; i < shardKeys.size(); ++i) {
+				std::vector<int> expected;
+				std::copy_if(shardKeys[i].begin(), shardKeys[i].end(), std::back_inserter(expected), keyPred);
+				FUZZ_CHECK(Keys(copy.shard(i)) == expected);
+			}
+			break;
+		}
+		case 4: {
+			const Sharded copy = src.next() % 2 == 0 ? sharded.Clone() : sharded.DeepCopy();
+			FUZZ_CHECK(Keys(copy.begin(), copy.end()) == globalKeys(shardKeys));
+			for (auto p : copy)
+				FUZZ_CHECK(std::find(sharded.begin(), sharded.end(), p) == sharded.end());
+			break;
+		}
+		default: {
+			Sharded moved{ std::move(sharded) };
+			FUZZ_CHECK(sharded.shards_count() == 0 && sharded.empty() && sharded.begin() == sharded.end());
+			FUZZ_CHECK(Keys(moved.begin(), moved.end()) == globalKeys(shardKeys));
+			sharded.clear();
+			sharded = std::move(moved);
+			FUZZ_CHECK(moved.shards_count() == 0 && moved.empty());
+			FUZZ_CHECK(Keys(sharded.begin(), sharded.end()) == globalKeys(shardKeys));
+			break;
+		}
+		}
+	}
+
+	using Slots = range_of_ptrs::slot_map<Counted>;
+
+	// Converts to a key by throwing, so constructing a Counted from it fails.
+	struct FailingKey {
+		operator int() const { throw std::runtime_error("key"); }
+	};
+
+	// slot_map against a list of (handle, key): erased handles must stay rejected, reused slots must
+	// hand out a newer generation, a throwing constructor must leave the map unchanged, and the
+	// packed values must work as a pointer range.
+	void CheckSlotMap(ByteSource& src)
+	{
+		Slots slots;
+		std::vector<std::pair<Slots::handle, int>> live;
+		std::vector<Slots::handle> stale;
+		std::vector<std::uint32_t> lastGeneration;
+
+		const std::size_t operations = src.next() % 64;
+		for (std::size_t op = 0; op < operations; ++op) {
+			const std::uint8_t byte = src.next();
+			if (byte % 7 == 0) {
+				bool thrown = false;
+				try {
+					slots.emplace(FailingKey{});
+				}
+				catch (const std::runtime_error&) {
+					thrown = true;
+				}
+				FUZZ_CHECK(thrown && slots.size() == live.size());
+			}
+			else if (live.empty() || byte % 3 != 0) {
+				const int key = byte % 8;
+				const Slots::handle h = slots.insert(Counted{ key });
+				// A fresh slot only when no freed one is left, and never skipping one.
+				FUZZ_CHECK(h.index <= lastGeneration.size());
+				FUZZ_CHECK((h.index == lastGeneration.size()) == (lastGeneration.size() == live.size()));
+				if (h.index < lastGeneration.size())
+					FUZZ_CHECK(h.generation > lastGeneration[h.index]);
+				else
+					lastGeneration.resize(h.index + 1);
+				lastGeneration[h.index] = h.generation;
+				live.emplace_back(h, key);
+			}
+			else if (byte % 2 == 0 || stale.empty()) {
+				const std::size_t victim = src.next() % live.size();
+				FUZZ_CHECK(slots.erase(live[victim].first));
+				stale.push_back(live[victim].first);
+				live.erase(live.begin() + victim);
+			}
+			else {
+				FUZZ_CHECK(!slots.erase(stale[src.next() % stale.size()]));
+			}
+		}
+
+		FUZZ_CHECK(slots.size() == live.size());
+		for (const auto& [h, key] : live) {
+			FUZZ_CHECK(slots.contains(h) && slots.get(h) != nullptr && slots[h].getKey() == key);
+			FUZZ_CHECK(slots.handle_at(static_cast<std::size_t>(slots.get(h) - &*slots.begin())) == h);
+		}
+		for (const auto& h : stale)
+			FUZZ_CHECK(!slots.contains(h) && slots.get(h) == nullptr);
+
+		std::vector<int> dense;
+		for (const Counted& value : slots)
+			dense.push_back(value.getKey());
+
+		switch (src.next() % 3) {
+		case 0: {
+			// The packed values as the source of Copy.
+			PtrVector to = MakeDefaultRange(slots.size());
+			FUZZ_CHECK(range_of_ptrs::Copy(slots.ptrs_begin(), slots.ptrs_end(), to.begin()) == to.end());
+			FUZZ_CHECK(Keys(to) == dense);
+			FreeDistinct(to);
+			break;
+		}
+		case 1: {
+			// ... and as its destination.
+			const PtrVector from = MakeRange(src, true);
+			const std::size_t count = std::min(from.size(), slots.size());
+			const auto last = range_of_ptrs::Copy(from.begin(), from.begin() + count, slots.ptrs_begin());
+			FUZZ_CHECK(last - slots.ptrs_begin() == static_cast<std::ptrdiff_t>(count));
+			std::vector<int> expected = Keys(from.begin(), from.begin() + count);
+			expected.insert(expected.end(), dense.begin() + count, dense.end());
+			FUZZ_CHECK(Keys(slots.ptrs_begin(), slots.ptrs_end()) == expected);
+			FreeDistinct(from);
+			break;
+		}
+		default: {
+			// Unique deletes pointees, so it runs on an owning deep copy of the packed values.
+			PtrVector copy = range_of_ptrs::DeepCopyOfRange<PtrVector>(slots.ptrs_begin(), slots.ptrs_end());
+			std::sort(copy.begin(), copy.end(), range_of_ptrs::BinaryFunctorDerefPtrsAdapter<std::less<>>());
+			copy.erase(range_of_ptrs::Unique(copy.begin(), copy.end()), copy.end());
+			std::sort(dense.begin(), dense.end());
+			dense.erase(std::unique(dense.begin(), dense.end()), dense.end());
+			FUZZ_CHECK(Keys(copy) == dense);
+			FreeDistinct(copy);
+			break;
+		}
+		}
+
+		slots.clear();
+		FUZZ_CHECK(slots.empty());
+		for (const auto& entry : live)
+			FUZZ_CHECK(!slots.contains(entry.first));
+	}
+
+	void CheckWrappers(ByteSource& src)
+	{
+		PtrVector range = MakeRange(src, false);
+		const std::size_t released = src.next() % (range.size() + 1);
+		{
+			range_of_ptrs::raii_ptrs_range_wrapper<PtrVector::iterator> owner{ range.begin() + released, range.end() };
+		}
+		range.resize(released);
+		{
+			range_of_ptrs::raii_ptrs_container_wrapper<PtrVector> owner{ range };
+		}
+	}
+
+
+	// A callable whose copy throws: starting a thread with it fails after the earlier workers
+	// are already running.
+	struct ThrowingCopy {
+		std::atomic<int>* ran;
+
+		ThrowingCopy(std::atomic<int>* counter) : ran{ counter } {}
+		ThrowingCopy(const ThrowingCopy&) { throw std::runtime_error("copy"); }
+		void operator()() const { ++*ran; }
+	};
+
+	// Failed thread starts must join the started workers instead of terminating, and an exception
+	// thrown by one part must surface only after every part ran.
+	void CheckParallel()
+	{
+		std::atomic<int> ran{ 0 };
+		bool thrown = false;
+		try {
+			range_of_ptrs::detail::joining_threads workers;
+			workers.start([&] { ++ran; });
+			workers.start([&] { ++ran; });
+			const ThrowingCopy failing{ &ran };
+			workers.start(failing);
+		}
+		catch (const std::runtime_error&) {
+			thrown = true;
+		}
+		FUZZ_CHECK(thrown && ran == 2);
+
+		for (std::size_t parts : { 1, 2, 5 }) {
+			std::vector<int> done(parts, 0);
+			thrown = false;
+			try {
+				range_of_ptrs::detail::ParallelParts(parts, [&](std::size_t part) {
+					done[part] = 1;
+					if (part == parts - 1) throw std::runtime_error("part");
+				});
+			}
+			catch (const std::runtime_error&) {
+				thrown = true;
+			}
+			FUZZ_CHECK(thrown && std::count(done.begin(), done.end(), 1) == static_cast<long>(parts));
+		}
+	}
+
+
+#if defined(RANGE_OF_PTRS_OWNERSHIP_TRACKING) && defined(RANGE_OF_PTRS_OWNERSHIP_SKIP_DOUBLE_DELETE)
+	// A deliberate double delete must be reported every time and never reach operator delete.
+	void CheckSkippedDoubleDelete()
+	{
+		range_of_ptrs::ownership::set_handler([](const range_of_ptrs::ownership::violation&) {});
+		Counted* ptr = RANGE_OF_PTRS_TRACK(new Counted(1));
+		RANGE_OF_PTRS_DELETE(ptr, "CheckSkippedDoubleDelete");
+		RANGE_OF_PTRS_DELETE(ptr, "CheckSkippedDoubleDelete");
+		RANGE_OF_PTRS_DELETE(ptr, "CheckSkippedDoubleDelete");
+
+		const auto reported = range_of_ptrs::ownership::violations();
+		FUZZ_CHECK(reported.size() == 2);
+		for (const auto& v : reported)
+			FUZZ_CHECK(v.kind == range_of_ptrs::ownership::violation_kind::double_delete && v.ptr == ptr);
+		FUZZ_CHECK(Counted::livingCount() == 0);
+		range_of_ptrs::ownership::set_handler(nullptr);
+		range_of_ptrs::ownership::reset();
+	}
+#endif
+
+	void RunOne(const std::uint8_t* data, std::size_t size)
+	{
+		using Check = void (*)(ByteSource&);
+		static const Check checks[] = {
+			CheckCopy, CheckCopyIf, CheckReplaceCopy, CheckClone,
+			CheckRemove, CheckUnique, CheckDeepCopy, CheckWrappers,
+			CheckNulls, CheckCopyIfToNew, CheckUninitialized, CheckAliasedDeepCopy,
+			CheckAbbreviated, CheckTagged, CheckSelect, CheckArgSort,
+			CheckSerialization, CheckSharded, CheckSlotMap
+		};
+
+		ByteSource src{ data, size };
+		while (!src.empty()) {
+			checks[src.next() % std::size(checks)](src);
+			FUZZ_CHECK(Counted::livingCount() == 0);
+#ifdef RANGE_OF_PTRS_OWNERSHIP_TRACKING
+			FUZZ_CHECK(range_of_ptrs::ownership::violations().empty());
+			FUZZ_CHECK(range_of_ptrs::ownership::live_count() == 0);
+#endif
+		}
+	}
+}
+
+
+extern "C" int LLVMFuzzerTestOneInput(const std::uint8_t* data, std::size_t size)
+{
+	fuzz::RunOne(data, size);
+	return 0;
+}
+
+#ifndef RANGE_OF_PTRS_LIBFUZZER
+int main(int argc, char* argv[])
+{
+	const long iterations = argc > 1 ? std::atol(argv[1]) : 20000;
+	const unsigned seed = argc > 2 ? static_cast<unsigned>(std::atol(argv[2])) : 20240601u;
+
+	std::mt19937 gen(seed);
+	std::uniform_int_distribution<int> byte(0, 255);
+	std::uniform_int_distribution<std::size_t> length(0, 512);
+
+	fuzz::CheckParallel();
+#if defined(RANGE_OF_PTRS_OWNERSHIP_TRACKING) && defined(RANGE_OF_PTRS_OWNERSHIP_SKIP_DOUBLE_DELETE)
+	fuzz::CheckSkippedDoubleDelete();
+#endif
+
+	std::vector<std::uint8_t> input;
+	for (long i = 0; i < iterations; ++i) {
+		input.resize(length(gen));
+		for (auto& b : input)
+			b = static_cast<std::uint8_t>(byte(gen));
+		fuzz::RunOne(input.data(), input.size());
+	}
+
+	std::printf("%ld random inputs passed (seed %u)\n", iterations, seed);
+	return 0;
+}
+#endif
@@ -0,0 +1,161 @@
+// Multi-producer stress test of concurrent_ptr_vector.
+//
+// Producers push tagged objects while a reader takes snapshots; afterwards every object must be
+// present exactly once and each producer's objects must appear in push order. A second test makes
+// the allocation of a new segment fail and checks that the failed push reserved nothing, so
+// snapshot() and release() still return.
+//
+// `range_of_ptrs_stress [rounds] [producers] [pushes per producer]`
+
+#include "ConcurrentPtrVector.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <thread>
+#include <vector>
+
+
+#define STRESS_CHECK(cond)                                                                 \
+	do {                                                                                   \
+		if (!(cond)) {                                                                     \
+			std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+			std::abort();                                                                  \
+		}                                                                                  \
+	} while (false)
+
+
+namespace stress
+{
+	// std::allocator that fails on the calling thread while failAllocation is set.
+	thread_local bool failAllocation = false;
+
+	template<typename T>
+	struct FailingAllocator {
+		using value_type = T;
+
+		FailingAllocator() = default;
+		template<typename U>
+		FailingAllocator(const FailingAllocator<U>&) noexcept {}
+
+		T* allocate(std::size_t count)
+		{
+			if (failAllocation)
+				throw std::bad_alloc();
+			return std::allocator<T>().allocate(count);
+		}
+		void deallocate(T* ptr, std::size_t count) noexcept { std::allocator<T>().deallocate(ptr, count); }
+
+		template<typename U>
+		bool operator==(const FailingAllocator<U>&) const noexcept { return true; }
+		template<typename U>
+		bool operator!=(const FailingAllocator<U>&) const noexcept { return false; }
+	};
+
+	struct Item {
+		Item(unsigned producer, unsigned seq) : producer_{ producer }, seq_{ seq } { ++living_; }
+		~Item() { --living_; }
+
+		unsigned producer_;
+		unsigned seq_;
+
+		static inline std::atomic<int> living_{ 0 };
+	};
+
+	void CheckProducers(unsigned producers, unsigned pushes)
+	{
+		{
+			range_of_ptrs::concurrent_ptr_vector<Item> vec;
+			std::atomic<unsigned> running{ producers };
+
+			std::thread reader([&] {
+				std::size_t previous = 0;
+				while (running.load() != 0) {
+					const std::vector<Item*> snapshot = vec.snapshot();
+					STRESS_CHECK(snapshot.size() >= previous);
+					for (Item* item : snapshot)
+						STRESS_CHECK(item != nullptr && item->producer_ < producers && item->seq_ < pushes);
+					previous = snapshot.size();
+				}
+			});
+
+			std::vector<std::thread> workers;
+			for (unsigned producer = 0; producer < producers; ++producer) {
+				workers.emplace_back([&, producer] {
+					std::size_t previous = 0;
+					for (unsigned seq = 0; seq < pushes; ++seq) {
+						const std::size_t index = vec.emplace_back(producer, seq);
+						STRESS_CHECK(seq == 0 || index > previous);
+						STRESS_CHECK(vec[index]->seq_ == seq);
+						previous = index;
+					}
+					--running;
+				});
+			}
+			for (auto& worker : workers)
+				worker.join();
+			reader.join();
+
+			STRESS_CHECK(vec.size() == std::size_t{ producers } * pushes);
+			const std::vector<Item*> all = vec.snapshot();
+			std::vector<unsigned> next(producers, 0);
+			for (Item* item : all) {
+				STRESS_CHECK(item->seq_ == next[item->producer_]);
+				++next[item->producer_];
+			}
+			for (unsigned count : next)
+				STRESS_CHECK(count == pushes);
+		}
+		STRESS_CHECK(Item::living_ == 0);
+	}
+
+	void CheckFailedSegmentAllocation()
+	{
+		{
+			range_of_ptrs::concurrent_ptr_vector<Item, FailingAllocator<Item*>> vec;
+			for (unsigned seq = 0; seq < 64; ++seq)     // fills the first segment exactly
+				vec.emplace_back(0u, seq);
+
+			Item* item = new Item(0, 64);
+			failAllocation = true;
+			bool thrown = false;
+			try {
+				vec.push_back(item);
+			}
+			catch (const std::bad_alloc&) {
+				thrown = true;
+			}
+			failAllocation = false;
+
+			STRESS_CHECK(thrown);
+			STRESS_CHECK(Item::living_ == 64);
+			STRESS_CHECK(vec.size() == 64);
+			STRESS_CHECK(vec.snapshot().size() == 64);
+
+			STRESS_CHECK(vec.emplace_back(0u, 64u) == 64);
+			std::vector<Item*> released = vec.release();
+			STRESS_CHECK(released.size() == 65 && vec.empty());
+			for (Item* p : released)
+				RANGE_OF_PTRS_DELETE(p, "CheckFailedSegmentAllocation");
+		}
+		STRESS_CHECK(Item::living_ == 0);
+	}
+}
+
+
+int main(int argc, char* argv[])
+{
+	const long rounds = argc > 1 ? std::atol(argv[1]) : 20;
+	const unsigned producers = argc > 2 ? static_cast<unsigned>(std::atol(argv[2])) : 4;
+	const unsigned pushes = argc > 3 ? static_cast<unsigned>(std::atol(argv[3])) : 20000;
+
+	stress::CheckFailedSegmentAllocation();
+	for (long i = 0; i < rounds; ++i)
+		stress::CheckProducers(producers, pushes);
+
+	std::printf("%ld rounds of %u producers x %u pushes passed\n", rounds, producers, pushes);
+	return 0;
+}